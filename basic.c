@@ -0,0 +1,3711 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "basic.h"
+#include "mos6510.h"
+#include "mem.h"
+#include "panic.h"
+
+/* BASIC pointers in zero page. */
+#define BASIC_VALTYP 0x0D /* Type of the last expression, and INTFLG. */
+#define BASIC_LINNUM 0x14 /* Line number being searched for. */
+#define BASIC_INDEX  0x22 /* Two pointers for indirect indexing. */
+#define BASIC_TXTTAB 0x2B /* Start of program text. */
+#define BASIC_VARTAB 0x2D /* Start of variables. */
+#define BASIC_ARYTAB 0x2F /* Start of arrays. */
+#define BASIC_STREND 0x31 /* End of arrays. */
+#define BASIC_FRETOP 0x33 /* Bottom of the string heap. */
+#define BASIC_MEMSIZ 0x37 /* Top of the string heap. */
+#define BASIC_VARNAM 0x45 /* Name of the variable being searched for. */
+#define BASIC_VARPNT 0x47 /* Value of the variable found. */
+#define BASIC_FORPNT 0x49 /* Variable being assigned to. */
+#define BASIC_OPPTR  0x4B /* Operator being evaluated, and OPMASK. */
+#define BASIC_LOWTR  0x5F
+
+/* Garbage collection state in zero page. */
+#define BASIC_TEMPPT 0x16 /* Next free temporary string descriptor. */
+#define BASIC_TEMPST 0x19 /* Temporary string descriptors, 3 of them. */
+#define BASIC_FOUR6  0x53 /* Descriptor step size. */
+#define BASIC_SIZE   0x55 /* Length offset in the moved descriptor. */
+#define BASIC_HIGHDS 0x58 /* Block move destination, the new FRETOP. */
+#define BASIC_HIGHTR 0x5A /* Block move source end. */
+
+/* Zero page used by the BASIC ROM floating point package. */
+#define BASIC_RESHO  0x26 /* Multiply and divide result, 4 bytes. */
+#define BASIC_RESLO  0x29
+#define BASIC_OLDOV  0x56
+#define BASIC_FACEXP 0x61
+#define BASIC_FACHO  0x62
+#define BASIC_FACMOH 0x63
+#define BASIC_FACMO  0x64
+#define BASIC_FACLO  0x65
+#define BASIC_FACSGN 0x66
+#define BASIC_BITS   0x68
+#define BASIC_ARGEXP 0x69
+#define BASIC_ARGHO  0x6A
+#define BASIC_ARGMOH 0x6B
+#define BASIC_ARGMO  0x6C
+#define BASIC_ARGLO  0x6D
+#define BASIC_ARGSGN 0x6E
+#define BASIC_ARISGN 0x6F
+#define BASIC_FACOV  0x70
+
+/* Entry points with ARG already unpacked and Z set from FACEXP. */
+#define BASIC_FADDT  0xB86A
+#define BASIC_FMULTT 0xBA2B
+#define BASIC_FDIVT  0xBB12
+
+/* Simple variable search loop in PTRGET, walking 7 byte entries from
+   VARTAB to ARYTAB. Trapped at the start, it continues at the compare with
+   LOWTR already at the right entry, or at ARYTAB to have it created. */
+#define BASIC_VAR_SEARCH   0xB0E7
+#define BASIC_VAR_COMPARE  0xB0EF
+#define BASIC_VAR_SIZE     7
+
+/* FNDLNC, walks the program lines from A/X for the first line number not
+   below LINNUM, leaving it in LOWTR with carry set if equal. FNDLIN runs
+   into it from TXTTAB, GOTO enters it at the next line when jumping
+   forward. */
+#define BASIC_LINE_SEARCH  0xA617
+#define BASIC_LINE_MAX     8192
+
+/* GARBAG, moves the strings still in use to the top of the heap one pass
+   at a time, each pass scanning all descriptors for the highest string
+   below FRETOP. FNDVAR is where every pass starts, the last one finding
+   nothing and returning. */
+#define BASIC_GC           0xB526
+#define BASIC_GC_PASS      0xB52A
+#define BASIC_GC_MAX       (UINT16_MAX / 3 + 4)
+
+/* CHRGET, copied to zero page at start and run for every character read
+   from the program text, skipping spaces and clearing carry for digits.
+   CHRGOT reads the current character again. The LDA operand in between
+   is TXTPTR itself. */
+#define BASIC_CHRGET       0x0073
+#define BASIC_CHRGOT       0x0079
+#define BASIC_TXTPTR       0x7A
+
+/* Statements are compiled where GONE starts the next one, with TXTPTR
+   just before it. Compiled code leaves through NEWSTT, which then checks
+   for STOP and moves on to the next statement or line, or through GONE
+   again for the statement after a THEN. */
+#define BASIC_NEWSTT       0xA7AE
+#define BASIC_GONE         0xA7E4
+#define BASIC_CURLIN       0x39 /* Current line, $FFxx in direct mode. */
+#define BASIC_FOR_SIZE     18   /* Bytes of a FOR entry on the stack. */
+#define BASIC_COMPILE_MAX     4096 /* Statements. */
+#define BASIC_COMPILE_OPS     65536
+#define BASIC_COMPILE_TEXT    (BASIC_COMPILE_MAX * 64)
+#define BASIC_COMPILE_LINE    0x100 /* Text up to the end of a line. */
+#define BASIC_COMPILE_STACK   16 /* Operands waiting for an operator. */
+#define BASIC_COMPILE_NESTING 10 /* Same as the ROM manages. */
+#define BASIC_COMPILE_NEXT    8  /* Variables after one NEXT. */
+#define BASIC_COMPILE_ARRAYS  256
+#define BASIC_COMPILE_STEPS   10000000
+
+/* Listings are tokenized like the ROM does for a line typed in. */
+#define BASIC_LISTING_START    0x0801 /* When TXTTAB is not setup yet. */
+#define BASIC_LISTING_END      0xA000
+#define BASIC_LISTING_LINE_MAX 255
+#define BASIC_LISTING_NUMBER_MAX 63999
+#define BASIC_TOKEN_FOR      0x81
+#define BASIC_TOKEN_NEXT     0x82
+#define BASIC_TOKEN_DATA     0x83
+#define BASIC_TOKEN_LET      0x88
+#define BASIC_TOKEN_GOTO     0x89
+#define BASIC_TOKEN_IF       0x8B
+#define BASIC_TOKEN_REM      0x8F
+#define BASIC_TOKEN_POKE     0x97
+#define BASIC_TOKEN_PRINT    0x99
+#define BASIC_TOKEN_THEN     0xA7
+#define BASIC_TOKEN_NOT      0xA8
+#define BASIC_TOKEN_PLUS     0xAA
+#define BASIC_TOKEN_MINUS    0xAB
+#define BASIC_TOKEN_MULTIPLY 0xAC
+#define BASIC_TOKEN_DIVIDE   0xAD
+#define BASIC_TOKEN_POWER    0xAE
+#define BASIC_TOKEN_AND      0xAF
+#define BASIC_TOKEN_OR       0xB0
+#define BASIC_TOKEN_GREATER  0xB1
+#define BASIC_TOKEN_EQUAL    0xB2
+#define BASIC_TOKEN_LESS     0xB3
+#define BASIC_TOKEN_SGN      0xB4
+#define BASIC_TOKEN_INT      0xB5
+#define BASIC_TOKEN_ABS      0xB6
+#define BASIC_TOKEN_PEEK     0xC2
+
+#define BASIC_TEST_RETURN 0x0334 /* Unused RAM, never executed. */
+#define BASIC_TEST_STEPS 100000
+
+typedef bool (*basic_fp_routine_t)(mos6510_t *, uint8_t *);
+
+typedef struct basic_fp_entry_s {
+  uint16_t address;
+  const char *name;
+  basic_fp_routine_t routine;
+  const uint8_t *code; /* Stock ROM code at the address. */
+  size_t size;
+} basic_fp_entry_t;
+
+typedef struct basic_gc_descriptor_s {
+  uint16_t address; /* Of the descriptor. */
+  uint16_t string;
+  uint16_t order; /* In the ROM scan, later ones win a tie. */
+  uint8_t length;
+  uint8_t size; /* Offset of the length. */
+} basic_gc_descriptor_t;
+
+typedef struct basic_listing_line_s {
+  uint16_t number;
+  uint16_t order; /* In the listing, a later line replaces an earlier. */
+  uint8_t length;
+  uint8_t text[BASIC_LISTING_LINE_MAX + 1];
+} basic_listing_line_t;
+
+typedef struct basic_escape_s {
+  const char *name;
+  uint8_t petscii;
+} basic_escape_t;
+
+typedef struct basic_native_s {
+  const char *name;
+  void (*enable)(bool);
+} basic_native_t;
+
+/* Expressions become a list of operations on FAC, the same steps the ROM
+   takes in FRMEVL, with the operands waiting for an operator pushed just
+   like it does. Statements end with one that leaves for the ROM. */
+typedef enum {
+  BASIC_OP_CONSTANT,
+  BASIC_OP_FLOAT,
+  BASIC_OP_INTEGER,
+  BASIC_OP_ELEMENT,
+  BASIC_OP_PUSH,
+  BASIC_OP_ADD,
+  BASIC_OP_SUBTRACT,
+  BASIC_OP_MULTIPLY,
+  BASIC_OP_DIVIDE,
+  BASIC_OP_COMPARE,
+  BASIC_OP_AND,
+  BASIC_OP_OR,
+  BASIC_OP_NEGATE,
+  BASIC_OP_NOT,
+  BASIC_OP_SGN,
+  BASIC_OP_INT,
+  BASIC_OP_ABS,
+  BASIC_OP_PEEK,
+  BASIC_OP_TARGET,
+  BASIC_OP_STORE,
+  BASIC_OP_STORE_ELEMENT,
+  BASIC_OP_ADDRESS,
+  BASIC_OP_POKE,
+  BASIC_OP_IF,
+  BASIC_OP_GOTO,
+  BASIC_OP_GONE,
+  BASIC_OP_NEXT,
+  BASIC_OP_END,
+} basic_op_type_t;
+
+typedef struct basic_op_s {
+  basic_op_type_t type;
+  uint8_t name[2]; /* Of the variable or array, or the compare mask. */
+  uint8_t value[5]; /* Constant as FACEXP and the mantissa. */
+  uint16_t address; /* Line number, TXTPTR to leave with or a variable. */
+} basic_op_t;
+
+typedef struct basic_statement_s {
+  uint16_t txtptr;
+  uint16_t start; /* Text from the statement to the end of the line. */
+  uint16_t length;
+  int text;
+  int op; /* First operation, -1 if left to the ROM. */
+  uint32_t generation[2];
+} basic_statement_t;
+
+typedef struct basic_parse_s {
+  mem_t *mem;
+  uint16_t position;
+  uint16_t end; /* Of the line. */
+  int depth;
+  int nesting;
+} basic_parse_t;
+
+typedef struct basic_run_s {
+  mos6510_t r;
+  uint8_t z[0x100]; /* Zero page copy, written back once done. */
+  uint8_t stack[BASIC_COMPILE_STACK][6];
+  int depth;
+  uint16_t target; /* Array element to store into. */
+  uint16_t address; /* To POKE. */
+  bool committed;
+} basic_run_t;
+
+static const uint8_t basic_faddt_code[] = {
+  0xD0, 0x03, 0x4C, 0xFC, 0xBB, 0xA6, 0x70, 0x86, 0x56, 0xA2, 0x69, 0xA5,
+  0x69, 0xA8,
+};
+
+static const uint8_t basic_fmultt_code[] = {
+  0xD0, 0x03, 0x4C, 0x8B, 0xBA, 0x20, 0xB7, 0xBA, 0xA9, 0x00, 0x85, 0x26,
+};
+
+static const uint8_t basic_fdivt_code[] = {
+  0xF0, 0x76, 0x20, 0x1B, 0xBC, 0xA9, 0x00, 0x38, 0xE5, 0x61, 0x85, 0x61,
+  0x20, 0xB7, 0xBA,
+};
+
+static const uint8_t basic_var_search_code[] = {
+  0xA5, 0x2D, 0xA6, 0x2E, 0xA0, 0x00, 0x86, 0x60, 0x85, 0x5F, 0xE4, 0x30,
+  0xD0, 0x04, 0xC5, 0x2F, 0xF0, 0x22, 0xA5, 0x45, 0xD1, 0x5F, 0xD0, 0x08,
+  0xA5, 0x46, 0xC8, 0xD1, 0x5F, 0xF0, 0x7D, 0x88, 0x18, 0xA5, 0x5F, 0x69,
+  0x07, 0x90, 0xE1, 0xE8, 0xD0, 0xDC,
+};
+
+static const uint8_t basic_line_search_code[] = {
+  0xA0, 0x01, 0x85, 0x5F, 0x86, 0x60, 0xB1, 0x5F, 0xF0, 0x1F, 0xC8, 0xC8,
+  0xA5, 0x15, 0xD1, 0x5F, 0x90, 0x18, 0xF0, 0x03, 0x88, 0xD0, 0x09, 0xA5,
+  0x14, 0x88, 0xD1, 0x5F, 0x90, 0x0C, 0xF0, 0x0A, 0x88, 0xB1, 0x5F, 0xAA,
+  0x88, 0xB1, 0x5F, 0xB0, 0xD7, 0x18, 0x60,
+};
+
+static const uint8_t basic_gc_code[] = {
+  0xA6, 0x37, 0xA5, 0x38, 0x86, 0x33, 0x85, 0x34, 0xA0, 0x00, 0x84, 0x4F,
+  0x84, 0x4E, 0xA5, 0x31, 0xA6, 0x32, 0x85, 0x5F, 0x86, 0x60, 0xA9, 0x19,
+  0xA2, 0x00, 0x85, 0x22, 0x86, 0x23,
+};
+
+static const uint8_t basic_gone_code[] = {
+  0x20, 0x73, 0x00, 0x20, 0xED, 0xA7, 0x4C, 0xAE, 0xA7,
+};
+
+static const uint8_t basic_chrget_code[] = {
+  0xE6, 0x7A, 0xD0, 0x02, 0xE6, 0x7B, 0xAD, 0x00, 0x00, 0xC9, 0x3A, 0xB0,
+  0x0A, 0xC9, 0x20, 0xF0, 0xEF, 0x38, 0xE9, 0x30, 0x38, 0xE9, 0xD0, 0x60,
+};
+
+static uint16_t basic_var_index[UINT16_MAX + 1]; /* Name to entry, or 0. */
+static uint16_t basic_var_names[UINT16_MAX / BASIC_VAR_SIZE + 1];
+static int basic_var_count = 0;
+static bool basic_var_valid = false;
+static uint16_t basic_var_vartab;
+static uint16_t basic_var_arytab;
+static uint16_t basic_var_strend;
+
+/* Lines in program order, with the end of program link after the last. */
+static uint16_t basic_line_address[BASIC_LINE_MAX + 1];
+static uint16_t basic_line_number[BASIC_LINE_MAX];
+static int basic_line_count = 0;
+static bool basic_line_sorted;
+static bool basic_line_valid = false;
+static uint16_t basic_line_txttab;
+static uint32_t basic_line_generation[MEM_PAGES];
+static uint8_t basic_line_tail[0x100]; /* Program text in the last page. */
+
+static basic_gc_descriptor_t basic_gc_descriptor[BASIC_GC_MAX];
+static int basic_gc_count;
+static bool basic_gc_checking = false;
+static bool basic_gc_running = false;
+static uint8_t basic_gc_ram[UINT16_MAX + 1];
+
+static basic_statement_t basic_compile_statement[BASIC_COMPILE_MAX];
+static basic_op_t basic_compile_op[BASIC_COMPILE_OPS];
+static uint8_t basic_compile_text[BASIC_COMPILE_TEXT];
+static uint16_t basic_compile_index[UINT16_MAX + 1]; /* TXTPTR, or 0. */
+static int basic_compile_count = 0;
+static int basic_compile_op_count = 0;
+static int basic_compile_text_count = 0;
+static bool basic_compile_checking = false;
+static bool basic_compile_running = false; /* Plain ROM, no native traps. */
+static uint8_t basic_compile_ram[UINT16_MAX + 1];
+static uint64_t basic_compile_checked = 0; /* Statements */
+static uint64_t basic_compile_time[2]; /* Nanoseconds, compiled and ROM. */
+static uint64_t basic_compile_cycles[2]; /* Spent in the ROM by each. */
+
+
+
+static inline uint16_t basic_word(mem_t *mem, uint8_t address)
+{
+  return mem->ram[address] + (mem->ram[address + 1] * 256);
+}
+
+
+
+static inline bool basic_rom_mapped(mem_t *mem, uint16_t address)
+{
+  return mem->read_page[address >> 8] == &mem->rom[address & 0xFF00];
+}
+
+
+
+/* Only hook into the stock ROM, not whatever else is loaded there. */
+static bool basic_rom_match(mem_t *mem, uint16_t address,
+  const uint8_t *code, size_t size)
+{
+  return basic_rom_mapped(mem, address) &&
+    memcmp(&mem->rom[address], code, size) == 0;
+}
+
+
+
+/* The routines below follow the ROM instruction by instruction where the
+   registers, flags or scratch bytes can be observed afterwards, working
+   on a copy of the CPU and zero page. Returning false means the ROM would
+   raise an error, and it is left to do so. */
+
+static inline uint8_t basic_nz(mos6510_t *r, uint8_t value)
+{
+  r->n_result = value;
+  r->z_result = value;
+  return value;
+}
+
+static inline void basic_adc(mos6510_t *r, uint8_t value)
+{
+  uint16_t sum = r->a + value + r->sr.c;
+  r->sr.v = ((~(r->a ^ value) & (r->a ^ sum)) >> 7) & 0x1;
+  r->sr.c = sum >> 8;
+  r->a = basic_nz(r, sum);
+}
+
+static inline void basic_sbc(mos6510_t *r, uint8_t value)
+{
+  basic_adc(r, ~value);
+}
+
+static inline void basic_cmp(mos6510_t *r, uint8_t reg, uint8_t value)
+{
+  r->sr.c = (reg >= value);
+  basic_nz(r, reg - value);
+}
+
+static inline uint8_t basic_asl(mos6510_t *r, uint8_t value)
+{
+  r->sr.c = value >> 7;
+  return basic_nz(r, value << 1);
+}
+
+static inline uint8_t basic_lsr(mos6510_t *r, uint8_t value)
+{
+  r->sr.c = value & 0x1;
+  return basic_nz(r, value >> 1);
+}
+
+static inline uint8_t basic_rol(mos6510_t *r, uint8_t value)
+{
+  uint8_t carry = r->sr.c;
+  r->sr.c = value >> 7;
+  return basic_nz(r, (value << 1) | carry);
+}
+
+static inline uint8_t basic_ror(mos6510_t *r, uint8_t value)
+{
+  uint8_t carry = r->sr.c;
+  r->sr.c = value & 0x1;
+  return basic_nz(r, (value >> 1) | (carry << 7));
+}
+
+
+
+/* ZEROFC */
+static bool basic_fp_zero(mos6510_t *r, uint8_t *z)
+{
+  r->a = basic_nz(r, 0);
+  z[BASIC_FACEXP] = 0;
+  z[BASIC_FACSGN] = 0;
+  return true;
+}
+
+
+
+/* SQUEEZ, shift the carry back in after the mantissa overflowed. */
+static bool basic_fp_squeeze(mos6510_t *r, uint8_t *z)
+{
+  if (! r->sr.c) {
+    return true;
+  }
+  z[BASIC_FACEXP] = basic_nz(r, z[BASIC_FACEXP] + 1);
+  if (z[BASIC_FACEXP] == 0) {
+    return false; /* ?OVERFLOW ERROR */
+  }
+  z[BASIC_FACHO]  = basic_ror(r, z[BASIC_FACHO]);
+  z[BASIC_FACMOH] = basic_ror(r, z[BASIC_FACMOH]);
+  z[BASIC_FACMO]  = basic_ror(r, z[BASIC_FACMO]);
+  z[BASIC_FACLO]  = basic_ror(r, z[BASIC_FACLO]);
+  z[BASIC_FACOV]  = basic_ror(r, z[BASIC_FACOV]);
+  return true;
+}
+
+
+
+/* NORMAL */
+static bool basic_fp_normal(mos6510_t *r, uint8_t *z)
+{
+  r->y = 0;
+  r->a = basic_nz(r, r->y);
+  r->sr.c = 0;
+
+  /* Whole bytes first, giving up on zero after four of them. */
+  r->x = basic_nz(r, z[BASIC_FACHO]);
+  while (r->x == 0) {
+    z[BASIC_FACHO]  = z[BASIC_FACMOH];
+    z[BASIC_FACMOH] = z[BASIC_FACMO];
+    z[BASIC_FACMO]  = z[BASIC_FACLO];
+    z[BASIC_FACLO]  = z[BASIC_FACOV];
+    r->x = z[BASIC_FACOV];
+    z[BASIC_FACOV]  = r->y;
+    basic_adc(r, 8);
+    basic_cmp(r, r->a, 32);
+    if (r->a == 32) {
+      return basic_fp_zero(r, z);
+    }
+    r->x = basic_nz(r, z[BASIC_FACHO]);
+  }
+
+  while ((z[BASIC_FACHO] & 0x80) == 0) {
+    basic_adc(r, 1);
+    z[BASIC_FACOV]  = basic_asl(r, z[BASIC_FACOV]);
+    z[BASIC_FACLO]  = basic_rol(r, z[BASIC_FACLO]);
+    z[BASIC_FACMO]  = basic_rol(r, z[BASIC_FACMO]);
+    z[BASIC_FACMOH] = basic_rol(r, z[BASIC_FACMOH]);
+    z[BASIC_FACHO]  = basic_rol(r, z[BASIC_FACHO]);
+  }
+
+  r->sr.c = 1;
+  basic_sbc(r, z[BASIC_FACEXP]);
+  if (r->sr.c) {
+    return basic_fp_zero(r, z);
+  }
+  r->a = basic_nz(r, r->a ^ 0xFF);
+  basic_adc(r, 1);
+  z[BASIC_FACEXP] = r->a;
+  return basic_fp_squeeze(r, z);
+}
+
+
+
+/* NEGFAC, two's complement of the mantissa and rounding byte. */
+static void basic_fp_negate(mos6510_t *r, uint8_t *z)
+{
+  int i;
+
+  r->a = basic_nz(r, z[BASIC_FACSGN] ^ 0xFF);
+  z[BASIC_FACSGN] = r->a;
+  for (i = BASIC_FACHO; i <= BASIC_FACLO; i++) {
+    r->a = basic_nz(r, z[i] ^ 0xFF);
+    z[i] = r->a;
+  }
+  r->a = basic_nz(r, z[BASIC_FACOV] ^ 0xFF);
+  z[BASIC_FACOV] = basic_nz(r, r->a + 1);
+  for (i = BASIC_FACLO; i >= BASIC_FACHO && r->z_result == 0; i--) {
+    z[i] = basic_nz(r, z[i] + 1);
+  }
+}
+
+
+
+/* SHFTR3 and ROLSHF, shift the number at X right by -Y bits. The top byte
+   keeps its sign bit, except when entered with it already shifted. */
+static void basic_fp_shift_bits(mos6510_t *r, uint8_t *z, bool top_shifted)
+{
+  uint8_t *n = &z[r->x];
+
+  do {
+    if (! top_shifted) {
+      n[1] = basic_asl(r, n[1]);
+      if (r->sr.c) {
+        n[1] = basic_nz(r, n[1] + 1);
+      }
+      n[1] = basic_ror(r, n[1]);
+      n[1] = basic_ror(r, n[1]);
+    }
+    top_shifted = false;
+    n[2] = basic_ror(r, n[2]);
+    n[3] = basic_ror(r, n[3]);
+    n[4] = basic_ror(r, n[4]);
+    r->a = basic_ror(r, r->a);
+    r->y = basic_nz(r, r->y + 1);
+  } while (r->y != 0);
+  r->sr.c = 0;
+}
+
+
+
+/* SHIFTR, shift the number at X right by -A bits, whole bytes through
+   FACOV first. */
+static void basic_fp_shift(mos6510_t *r, uint8_t *z)
+{
+  uint8_t *n = &z[r->x];
+
+  basic_adc(r, 8);
+  while ((r->n_result & 0x80) || r->z_result == 0) {
+    z[BASIC_FACOV] = n[4];
+    n[4] = n[3];
+    n[3] = n[2];
+    n[2] = n[1];
+    r->y = z[BASIC_BITS];
+    n[1] = r->y;
+    basic_adc(r, 8);
+  }
+  basic_sbc(r, 8);
+  r->y = basic_nz(r, r->a);
+  r->a = basic_nz(r, z[BASIC_FACOV]);
+  if (r->sr.c) {
+    r->sr.c = 0;
+    return;
+  }
+  basic_fp_shift_bits(r, z, false);
+}
+
+
+
+/* FADDT, FAC = ARG + FAC. */
+static bool basic_fp_add(mos6510_t *r, uint8_t *z)
+{
+  int i;
+
+  r->x = basic_nz(r, z[BASIC_FACOV]);
+  z[BASIC_OLDOV] = r->x;
+  r->x = BASIC_ARGEXP;
+  r->a = z[BASIC_ARGEXP];
+  r->y = basic_nz(r, r->a);
+  if (r->y == 0) {
+    return true; /* Adding zero. */
+  }
+
+  /* Align the smaller number to the bigger one. */
+  r->sr.c = 1;
+  basic_sbc(r, z[BASIC_FACEXP]);
+  if (r->a != 0) {
+    if (r->sr.c) {
+      z[BASIC_FACEXP] = r->y;
+      r->y = z[BASIC_ARGSGN];
+      z[BASIC_FACSGN] = r->y;
+      r->a = basic_nz(r, r->a ^ 0xFF);
+      basic_adc(r, 0);
+      r->y = 0;
+      z[BASIC_OLDOV] = r->y;
+      r->x = BASIC_FACEXP;
+    } else {
+      r->y = 0;
+      z[BASIC_FACOV] = r->y;
+    }
+    basic_cmp(r, r->a, 0xF9);
+    if (r->n_result & 0x80) {
+      basic_fp_shift(r, z);
+    } else {
+      r->y = r->a;
+      r->a = z[BASIC_FACOV];
+      z[r->x + 1] = basic_lsr(r, z[r->x + 1]);
+      basic_fp_shift_bits(r, z, true);
+    }
+  }
+
+  /* BIT ARISGN */
+  r->n_result = z[BASIC_ARISGN];
+  r->sr.v = (z[BASIC_ARISGN] >> 6) & 0x1;
+  r->z_result = r->a & z[BASIC_ARISGN];
+
+  if ((z[BASIC_ARISGN] & 0x80) == 0) {
+    basic_adc(r, z[BASIC_OLDOV]);
+    z[BASIC_FACOV] = r->a;
+    for (i = 4; i >= 1; i--) {
+      r->a = z[BASIC_FACEXP + i];
+      basic_adc(r, z[BASIC_ARGEXP + i]);
+      z[BASIC_FACEXP + i] = r->a;
+    }
+    return basic_fp_squeeze(r, z);
+  }
+
+  /* Subtract the smaller number from the bigger one. */
+  r->y = BASIC_FACEXP;
+  basic_cmp(r, r->x, BASIC_ARGEXP);
+  if (r->x != BASIC_ARGEXP) {
+    r->y = basic_nz(r, BASIC_ARGEXP);
+  }
+  r->sr.c = 1;
+  r->a = basic_nz(r, r->a ^ 0xFF);
+  basic_adc(r, z[BASIC_OLDOV]);
+  z[BASIC_FACOV] = r->a;
+  for (i = 4; i >= 1; i--) {
+    r->a = z[r->y + i];
+    basic_sbc(r, z[r->x + i]);
+    z[BASIC_FACEXP + i] = r->a;
+  }
+  if (! r->sr.c) {
+    basic_fp_negate(r, z);
+  }
+  return basic_fp_normal(r, z);
+}
+
+
+
+/* MULDIV, combine the exponents. Results the ROM turns into zero are left
+   to it as well, together with the overflow error. */
+static bool basic_fp_exponent(uint8_t *z)
+{
+  int sum;
+
+  if (z[BASIC_ARGEXP] == 0) {
+    return false;
+  }
+  sum = z[BASIC_ARGEXP] + z[BASIC_FACEXP];
+  if (sum <= 0x80 || sum >= 0x180) {
+    return false;
+  }
+  z[BASIC_FACEXP] = sum - 0x80;
+  z[BASIC_FACSGN] = z[BASIC_ARISGN];
+  return true;
+}
+
+
+
+/* MOVFR */
+static bool basic_fp_result(mos6510_t *r, uint8_t *z, uint32_t result)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    z[BASIC_RESHO + i] = result >> (24 - (i * 8));
+    z[BASIC_FACHO + i] = z[BASIC_RESHO + i];
+  }
+  return basic_fp_normal(r, z);
+}
+
+
+
+/* FMULTT, FAC = ARG * FAC. For each FAC byte from FACOV up, the ROM adds
+   ARG into RESHO and shifts the lot right through FACOV bit by bit, which
+   comes to the same as adding the byte times ARG and dropping the lowest
+   byte. A zero byte below FACHO is shifted in whole instead, bringing
+   BITS in at the top. */
+static bool basic_fp_multiply(mos6510_t *r, uint8_t *z)
+{
+  static const uint8_t factor[] = {
+    BASIC_FACOV, BASIC_FACLO, BASIC_FACMO, BASIC_FACMOH, BASIC_FACHO,
+  };
+  uint64_t arg;
+  uint64_t product; /* RESHO to RESLO and FACOV. */
+  uint8_t value;
+  int i;
+
+  if (! basic_fp_exponent(z)) {
+    return false;
+  }
+
+  arg = ((uint32_t)z[BASIC_ARGHO] << 24) | (z[BASIC_ARGMOH] << 16) |
+        (z[BASIC_ARGMO] << 8) | z[BASIC_ARGLO];
+  product = z[BASIC_FACOV];
+  for (i = 0; i < 5; i++) {
+    value = z[factor[i]];
+    product = (product + (value * (arg << 8))) >> 8;
+    if (value == 0 && i < 4) {
+      product |= (uint64_t)z[BASIC_BITS] << 32;
+    }
+  }
+
+  z[BASIC_FACOV] = product & 0xFF;
+  return basic_fp_result(r, z, product >> 8);
+}
+
+
+
+/* ROUND */
+static bool basic_fp_round(mos6510_t *r, uint8_t *z)
+{
+  int i;
+
+  if (z[BASIC_FACEXP] == 0) {
+    return true;
+  }
+  z[BASIC_FACOV] = basic_asl(r, z[BASIC_FACOV]);
+  if (! r->sr.c) {
+    return true;
+  }
+  for (i = BASIC_FACLO; i >= BASIC_FACHO; i--) {
+    z[i]++;
+    if (z[i] != 0) {
+      return true;
+    }
+  }
+  return basic_fp_squeeze(r, z);
+}
+
+
+
+/* FDIVT, FAC = ARG / FAC. Restoring division of the mantissas into RESHO,
+   plus two more quotient bits for FACOV, leaving the remainder in ARG. */
+static bool basic_fp_divide(mos6510_t *r, uint8_t *z)
+{
+  uint64_t divisor;
+  uint64_t remainder;
+  uint64_t quotient;
+  int i;
+
+  if (! basic_fp_round(r, z)) {
+    return false;
+  }
+  z[BASIC_FACEXP] = 0 - z[BASIC_FACEXP];
+  if (! basic_fp_exponent(z)) {
+    return false;
+  }
+  z[BASIC_FACEXP]++;
+  if (z[BASIC_FACEXP] == 0) {
+    return false; /* ?OVERFLOW ERROR */
+  }
+
+  divisor = ((uint32_t)z[BASIC_FACHO] << 24) | (z[BASIC_FACMOH] << 16) |
+            (z[BASIC_FACMO] << 8) | z[BASIC_FACLO];
+  remainder = ((uint32_t)z[BASIC_ARGHO] << 24) | (z[BASIC_ARGMOH] << 16) |
+              (z[BASIC_ARGMO] << 8) | z[BASIC_ARGLO];
+  quotient = 0;
+  for (i = 0; i < 34; i++) {
+    quotient <<= 1;
+    if (remainder >= divisor) {
+      quotient |= 1;
+      if (i < 33) {
+        remainder -= divisor;
+      }
+    }
+    if (i < 33) {
+      remainder <<= 1;
+    }
+  }
+
+  z[BASIC_ARGHO]  = remainder >> 24;
+  z[BASIC_ARGMOH] = remainder >> 16;
+  z[BASIC_ARGMO]  = remainder >> 8;
+  z[BASIC_ARGLO]  = remainder;
+  z[BASIC_RESLO + 1] = quotient & 0x3;
+  z[BASIC_FACOV] = (quotient & 0x3) << 6;
+  return basic_fp_result(r, z, quotient >> 2);
+}
+
+
+
+static const basic_fp_entry_t basic_fp_entries[] = {
+  {BASIC_FADDT,  "FADDT",  basic_fp_add,
+    basic_faddt_code,  sizeof(basic_faddt_code)},
+  {BASIC_FMULTT, "FMULTT", basic_fp_multiply,
+    basic_fmultt_code, sizeof(basic_fmultt_code)},
+  {BASIC_FDIVT,  "FDIVT",  basic_fp_divide,
+    basic_fdivt_code,  sizeof(basic_fdivt_code)},
+};
+
+#define BASIC_FP_ENTRIES \
+  (int)(sizeof(basic_fp_entries) / sizeof(basic_fp_entries[0]))
+
+
+
+static const basic_fp_entry_t *basic_fp_entry(uint16_t address)
+{
+  int i;
+
+  for (i = 0; i < BASIC_FP_ENTRIES; i++) {
+    if (basic_fp_entries[i].address == address) {
+      return &basic_fp_entries[i];
+    }
+  }
+  return NULL;
+}
+
+
+
+/* Run natively on copies, so nothing changes if the ROM has to do it. */
+static bool basic_fp_native(const basic_fp_entry_t *entry,
+  mos6510_t *cpu, uint8_t *zp)
+{
+  mos6510_t r;
+  uint8_t z[0x100];
+
+  /* Zero FAC is a quick return or an error in the ROM, and the package
+     never runs with decimal mode set. */
+  if (cpu->z_result == 0 || cpu->sr.d) {
+    return false;
+  }
+
+  r = *cpu;
+  memcpy(z, zp, sizeof(z));
+  if (! (entry->routine)(&r, z)) {
+    return false;
+  }
+  *cpu = r;
+  memcpy(zp, z, sizeof(z));
+  return true;
+}
+
+
+
+static bool basic_fp_trap(mos6510_t *cpu, mem_t *mem)
+{
+  const basic_fp_entry_t *entry;
+
+  if (basic_compile_running) {
+    return false;
+  }
+  entry = basic_fp_entry(cpu->pc);
+  if (entry == NULL ||
+      ! basic_rom_match(mem, entry->address, entry->code, entry->size)) {
+    return false;
+  }
+  if (! basic_fp_native(entry, cpu, mem->ram)) {
+    return false;
+  }
+
+  /* Only the RTS is counted, not the cycles the ROM would have used. */
+  mos6510_trap_return(cpu, mem);
+  return true;
+}
+
+
+
+void basic_fp_enable(bool enable)
+{
+  int i;
+
+  for (i = 0; i < BASIC_FP_ENTRIES; i++) {
+    mos6510_trap_set(basic_fp_entries[i].address,
+      (enable) ? basic_fp_trap : NULL);
+  }
+}
+
+
+
+static void basic_var_add(mem_t *mem, uint16_t address)
+{
+  uint16_t name;
+
+  name = mem->ram[address] + (mem->ram[address + 1] * 256);
+  if (basic_var_index[name] == 0) { /* The ROM finds the first one. */
+    basic_var_index[name] = address;
+    basic_var_names[basic_var_count++] = name;
+  }
+}
+
+
+
+static void basic_var_clear(void)
+{
+  int i;
+
+  for (i = 0; i < basic_var_count; i++) {
+    basic_var_index[basic_var_names[i]] = 0;
+  }
+  basic_var_count = 0;
+  basic_var_valid = false;
+}
+
+
+
+static bool basic_var_build(mem_t *mem)
+{
+  uint16_t vartab;
+  uint16_t arytab;
+  uint16_t strend;
+  uint16_t address;
+
+  vartab = basic_word(mem, BASIC_VARTAB);
+  arytab = basic_word(mem, BASIC_ARYTAB);
+  strend = basic_word(mem, BASIC_STREND);
+  if (basic_var_valid && vartab == basic_var_vartab &&
+      arytab == basic_var_arytab && strend == basic_var_strend) {
+    return true;
+  }
+
+  /* A new variable is put at the old ARYTAB, with the arrays moved up. */
+  if (basic_var_valid && vartab == basic_var_vartab &&
+      arytab == basic_var_arytab + BASIC_VAR_SIZE &&
+      strend == basic_var_strend + BASIC_VAR_SIZE) {
+    basic_var_add(mem, basic_var_arytab);
+    basic_var_arytab = arytab;
+    basic_var_strend = strend;
+    return true;
+  }
+
+  /* Anything else, like editing the program, CLR or a new array. Leave
+     odd layouts, such as variables under the ROMs, to the ROM. */
+  basic_var_clear();
+  if (arytab < vartab || arytab > 0xA000 ||
+      (arytab - vartab) % BASIC_VAR_SIZE != 0) {
+    return false;
+  }
+  for (address = vartab; address != arytab; address += BASIC_VAR_SIZE) {
+    basic_var_add(mem, address);
+  }
+  basic_var_vartab = vartab;
+  basic_var_arytab = arytab;
+  basic_var_strend = strend;
+  basic_var_valid = true;
+  return true;
+}
+
+
+
+static bool basic_var_trap(mos6510_t *cpu, mem_t *mem)
+{
+  uint16_t name;
+  uint16_t address;
+  uint8_t previous;
+
+  if (basic_compile_running) {
+    return false;
+  }
+  if (! basic_rom_match(mem, BASIC_VAR_SEARCH, basic_var_search_code,
+    sizeof(basic_var_search_code))) {
+    return false;
+  }
+  if (! basic_var_build(mem)) {
+    return false;
+  }
+
+  name = mem->ram[BASIC_VARNAM] + (mem->ram[BASIC_VARNAM + 1] * 256);
+  address = basic_var_index[name];
+  if (address == 0) {
+    address = basic_var_arytab; /* Not found. */
+  } else if (mem->ram[address] != mem->ram[BASIC_VARNAM] ||
+    mem->ram[address + 1] != mem->ram[BASIC_VARNAM + 1]) {
+    basic_var_clear(); /* Changed behind our back, search the slow way. */
+    return false;
+  }
+
+  /* Same as leaving the loop for that entry, except for the cycles. Only
+     the overflow flag is left over from stepping to it with ADC #7. */
+  if (address != basic_var_vartab) {
+    previous = (address - BASIC_VAR_SIZE) & 0xFF;
+    cpu->sr.v = ((~(previous ^ BASIC_VAR_SIZE) & (previous ^ address)) >> 7)
+      & 0x1;
+  }
+  mem->ram[BASIC_LOWTR + 1] = address >> 8;
+  cpu->a = address & 0xFF;
+  cpu->x = address >> 8;
+  cpu->y = 0;
+  cpu->pc = BASIC_VAR_COMPARE;
+  return true;
+}
+
+
+
+void basic_var_enable(bool enable)
+{
+  basic_var_clear();
+  mos6510_trap_set(BASIC_VAR_SEARCH, (enable) ? basic_var_trap : NULL);
+}
+
+
+
+/* Writes to the program text are caught through the code generation of
+   its pages, except for the last one which is shared with the variables
+   and compared byte by byte instead. */
+static bool basic_line_changed(mem_t *mem)
+{
+  uint16_t end;
+  uint16_t start;
+  int page;
+
+  if (basic_word(mem, BASIC_TXTTAB) != basic_line_txttab) {
+    return true;
+  }
+  end = basic_line_address[basic_line_count] + 1;
+  for (page = basic_line_txttab >> 8; page < (end >> 8); page++) {
+    if (mem->code_generation[page] != basic_line_generation[page]) {
+      return true;
+    }
+  }
+  start = ((basic_line_txttab >> 8) == (end >> 8)) ?
+    basic_line_txttab : end & 0xFF00;
+  return memcmp(&mem->ram[start], basic_line_tail, end + 1 - start) != 0;
+}
+
+
+
+static bool basic_line_build(mem_t *mem)
+{
+  uint16_t address;
+  uint16_t next;
+  uint16_t end;
+  uint16_t start;
+  int page;
+
+  basic_line_valid = false;
+  basic_line_count = 0;
+  basic_line_sorted = true;
+  basic_line_txttab = basic_word(mem, BASIC_TXTTAB);
+
+  /* Leave programs under the ROMs or with odd links to the ROM. */
+  address = basic_line_txttab;
+  if (address >= 0x9FFF) {
+    return false;
+  }
+  while (mem->ram[address + 1] != 0) {
+    next = mem->ram[address] + (mem->ram[address + 1] * 256);
+    if (basic_line_count >= BASIC_LINE_MAX ||
+        next <= address || next >= 0x9FFF) {
+      return false;
+    }
+    basic_line_address[basic_line_count] = address;
+    basic_line_number[basic_line_count] =
+      mem->ram[address + 2] + (mem->ram[address + 3] * 256);
+    if (basic_line_count > 0 && basic_line_number[basic_line_count] <=
+      basic_line_number[basic_line_count - 1]) {
+      basic_line_sorted = false;
+    }
+    basic_line_count++;
+    address = next;
+  }
+  basic_line_address[basic_line_count] = address;
+
+  end = address + 1;
+  for (page = basic_line_txttab >> 8; page < (end >> 8); page++) {
+    mem_code_mark(mem, page << 8);
+    basic_line_generation[page] = mem->code_generation[page];
+  }
+  start = ((basic_line_txttab >> 8) == (end >> 8)) ?
+    basic_line_txttab : end & 0xFF00;
+  memcpy(basic_line_tail, &mem->ram[start], end + 1 - start);
+  basic_line_valid = true;
+  return true;
+}
+
+
+
+/* Position of a line start, or the end of program, in the index. */
+static int basic_line_position(uint16_t address)
+{
+  int low;
+  int high;
+  int middle;
+
+  low = 0;
+  high = basic_line_count;
+  while (low <= high) {
+    middle = (low + high) / 2;
+    if (basic_line_address[middle] == address) {
+      return middle;
+    } else if (basic_line_address[middle] < address) {
+      low = middle + 1;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return -1;
+}
+
+
+
+/* First line from a position on with a number not below the one given. */
+static int basic_line_find(int position, uint16_t number)
+{
+  int high;
+  int middle;
+
+  if (! basic_line_sorted) {
+    while (position < basic_line_count &&
+      basic_line_number[position] < number) {
+      position++;
+    }
+    return position;
+  }
+
+  high = basic_line_count;
+  while (position < high) {
+    middle = (position + high) / 2;
+    if (basic_line_number[middle] < number) {
+      position = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return position;
+}
+
+
+
+static bool basic_line_trap(mos6510_t *cpu, mem_t *mem)
+{
+  uint16_t address;
+  uint16_t number;
+  int position;
+
+  if (basic_compile_running) {
+    return false;
+  }
+  if (! basic_rom_match(mem, BASIC_LINE_SEARCH, basic_line_search_code,
+    sizeof(basic_line_search_code))) {
+    return false;
+  }
+  if (! basic_line_valid || basic_line_changed(mem)) {
+    if (! basic_line_build(mem)) {
+      return false;
+    }
+  }
+  position = basic_line_position(cpu->a + (cpu->x * 256));
+  if (position < 0) {
+    return false; /* Not from the start of a line. */
+  }
+
+  number = mem->ram[BASIC_LINNUM] + (mem->ram[BASIC_LINNUM + 1] * 256);
+  position = basic_line_find(position, number);
+  address = basic_line_address[position];
+  mem->ram[BASIC_LOWTR] = address & 0xFF;
+  mem->ram[BASIC_LOWTR + 1] = address >> 8;
+  cpu->x = address >> 8;
+
+  /* Registers and flags as left by the compare the ROM would end on. */
+  if (position == basic_line_count) {
+    cpu->a = 0;
+    cpu->y = 1;
+    cpu->sr.c = 0;
+    cpu->n_result = cpu->z_result = 0;
+  } else if ((number >> 8) < mem->ram[address + 3]) {
+    cpu->a = number >> 8;
+    cpu->y = 3;
+    cpu->sr.c = 0;
+    cpu->n_result = cpu->z_result = cpu->a - mem->ram[address + 3];
+  } else {
+    cpu->a = number & 0xFF;
+    cpu->y = 2;
+    cpu->sr.c = (cpu->a >= mem->ram[address + 2]);
+    cpu->n_result = cpu->z_result = cpu->a - mem->ram[address + 2];
+  }
+
+  mos6510_trap_return(cpu, mem);
+  return true;
+}
+
+
+
+void basic_line_enable(bool enable)
+{
+  basic_line_valid = false;
+  mos6510_trap_set(BASIC_LINE_SEARCH, (enable) ? basic_line_trap : NULL);
+}
+
+
+
+static bool basic_gc_add(mem_t *mem, uint16_t address, uint8_t size)
+{
+  basic_gc_descriptor_t *d;
+
+  if (mem->ram[address + size] == 0) {
+    return true; /* Empty strings are never moved. */
+  }
+  d = &basic_gc_descriptor[basic_gc_count];
+  d->address = address;
+  d->size = size;
+  d->length = mem->ram[address + size];
+  d->string = mem->ram[address + size + 1] +
+    (mem->ram[address + size + 2] * 256);
+  d->order = basic_gc_count;
+  basic_gc_count++;
+
+  /* The ROM would copy from the BASIC ROM above the heap. */
+  return d->string >= 0xA000 || d->string + d->length <= 0xA000;
+}
+
+
+
+/* Collect the string descriptors in the order the ROM scans them, giving
+   up on anything the ROM would not walk the usual way. */
+static bool basic_gc_collect(mem_t *mem)
+{
+  uint16_t vartab;
+  uint16_t arytab;
+  uint16_t strend;
+  uint16_t memsiz;
+  uint16_t address;
+  uint16_t next;
+  uint16_t element;
+  int page;
+
+  vartab = basic_word(mem, BASIC_VARTAB);
+  arytab = basic_word(mem, BASIC_ARYTAB);
+  strend = basic_word(mem, BASIC_STREND);
+  memsiz = basic_word(mem, BASIC_MEMSIZ);
+  if (vartab > arytab || arytab > strend || strend > memsiz ||
+      memsiz > 0xA000 || (arytab - vartab) % BASIC_VAR_SIZE != 0) {
+    return false;
+  }
+  if (mem->ram[BASIC_FOUR6] != 3 || mem->ram[BASIC_TEMPPT] < BASIC_TEMPST ||
+      mem->ram[BASIC_TEMPPT] > BASIC_TEMPST + 9 ||
+      (mem->ram[BASIC_TEMPPT] - BASIC_TEMPST) % 3 != 0) {
+    return false;
+  }
+  for (page = vartab >> 8; page <= (memsiz - 1) >> 8; page++) {
+    if (mem->read_page[page] != &mem->ram[page * 0x100]) {
+      return false;
+    }
+  }
+
+  basic_gc_count = 0;
+  for (address = BASIC_TEMPST; address != mem->ram[BASIC_TEMPPT];
+    address += 3) {
+    if (! basic_gc_add(mem, address, 0)) {
+      return false;
+    }
+  }
+  for (address = vartab; address != arytab; address += BASIC_VAR_SIZE) {
+    if ((mem->ram[address] & 0x80) == 0 && (mem->ram[address + 1] & 0x80)) {
+      if (! basic_gc_add(mem, address, 2)) {
+        return false;
+      }
+    }
+  }
+  for (address = arytab; address != strend; address = next) {
+    next = address + mem->ram[address + 2] + (mem->ram[address + 3] * 256);
+    if (next <= address || next > strend) {
+      return false;
+    }
+    if ((mem->ram[address] & 0x80) || (mem->ram[address + 1] & 0x80) == 0) {
+      continue; /* Not a string array. */
+    }
+    if (mem->ram[address + 4] >= 0x80) {
+      return false;
+    }
+    element = address + (mem->ram[address + 4] * 2) + 5;
+    if (element > next || (next - element) % 3 != 0) {
+      return false;
+    }
+    for (; element != next; element += 3) {
+      if (! basic_gc_add(mem, element, 0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+
+/* Highest string first, the last scanned descriptor first on a tie. */
+static int basic_gc_compare(const void *a, const void *b)
+{
+  const basic_gc_descriptor_t *da = a;
+  const basic_gc_descriptor_t *db = b;
+
+  if (da->string != db->string) {
+    return (da->string > db->string) ? -1 : 1;
+  }
+  return (da->order > db->order) ? -1 : 1;
+}
+
+
+
+/* Each ROM pass moves the highest string below FRETOP, so going through
+   the strings from the top gives the same moves in the same order. Once
+   a string is at or above FRETOP it is never picked again, which also
+   copies a string once more for every other descriptor pointing at it,
+   like the ROM does. */
+static void basic_gc_native(mos6510_t *cpu, mem_t *mem)
+{
+  basic_gc_descriptor_t *d;
+  uint16_t strend;
+  uint16_t fretop;
+  uint16_t target;
+  int i;
+  int j;
+
+  qsort(basic_gc_descriptor, basic_gc_count, sizeof(basic_gc_descriptor_t),
+    basic_gc_compare);
+
+  strend = basic_word(mem, BASIC_STREND);
+  fretop = basic_word(mem, BASIC_MEMSIZ);
+  for (i = 0; i < basic_gc_count; i++) {
+    d = &basic_gc_descriptor[i];
+    if (d->string >= fretop) {
+      continue;
+    }
+    if (d->string < strend) {
+      break; /* In the program text, all the rest as well. */
+    }
+
+    /* Copied from the top down, just like BLTUC. */
+    target = fretop - d->length;
+    for (j = d->length - 1; j >= 0; j--) {
+      mem_write(mem, target + j, mem->ram[d->string + j]);
+    }
+    mem_write(mem, d->address + d->size + 1, target & 0xFF);
+    mem_write(mem, d->address + d->size + 2, target >> 8);
+    fretop = target;
+
+    /* Left behind by the last move, HIGHDS is set to FRETOP and bumped
+       back up again after BLTUC. */
+    mem->ram[BASIC_HIGHTR] = d->string & 0xFF;
+    mem->ram[BASIC_HIGHTR + 1] = (d->string >> 8) - 1;
+    mem->ram[BASIC_HIGHDS] = target & 0xFF;
+    mem->ram[BASIC_HIGHDS + 1] = target >> 8;
+    mem->ram[BASIC_SIZE] = d->size;
+  }
+
+  /* The final pass that finds nothing is left to the ROM, it leaves all
+     the pointers, registers and flags as they should be. */
+  cpu->x = fretop & 0xFF;
+  cpu->a = fretop >> 8;
+  cpu->pc = BASIC_GC_PASS;
+}
+
+
+
+/* Run the ROM until it returns from the garbage collection. */
+static void basic_gc_rom(mos6510_t *cpu, mem_t *mem, uint8_t sp)
+{
+  uint8_t cycles;
+
+  cycles = cpu->cycles;
+  while (cpu->sp != (uint8_t)(sp + 2)) {
+    mos6510_execute(cpu, mem);
+  }
+  cpu->cycles = cycles;
+}
+
+
+
+/* Run both the native and ROM garbage collection from the same state and
+   compare all of RAM afterwards, carrying on with the ROM result. */
+static void basic_gc_check(mos6510_t *cpu, mem_t *mem)
+{
+  mos6510_t start;
+  mos6510_t native;
+  uint8_t native_status;
+  uint8_t rom_status;
+  uint8_t value;
+  int differences;
+  int first;
+  int i;
+
+  start = *cpu;
+  memcpy(basic_gc_ram, mem->ram, sizeof(basic_gc_ram));
+  basic_gc_native(cpu, mem);
+  basic_gc_rom(cpu, mem, start.sp);
+  native = *cpu;
+  mos6510_status_sync(&native);
+  native_status = (native.sr.n << 7) | (native.sr.v << 6) |
+    (native.sr.z << 1) | native.sr.c;
+
+  /* Swap in the starting RAM, keeping the native result for comparing. */
+  for (i = 0; i <= UINT16_MAX; i++) {
+    value = mem->ram[i];
+    mem->ram[i] = basic_gc_ram[i];
+    basic_gc_ram[i] = value;
+  }
+  mem_code_flush(mem);
+  *cpu = start;
+  basic_gc_running = true;
+  basic_gc_rom(cpu, mem, start.sp);
+  basic_gc_running = false;
+  mos6510_status_sync(cpu);
+  rom_status = (cpu->sr.n << 7) | (cpu->sr.v << 6) |
+    (cpu->sr.z << 1) | cpu->sr.c;
+
+  differences = 0;
+  first = -1;
+  for (i = 0; i <= UINT16_MAX; i++) {
+    if (mem->ram[i] != basic_gc_ram[i]) {
+      if (first < 0) {
+        first = i;
+      }
+      differences++;
+    }
+  }
+  if (differences > 0) {
+    panic("Native garbage collection differs in %d bytes, first at $%04x "
+      "(ROM %02x, Native %02x)", differences, first, mem->ram[first],
+      basic_gc_ram[first]);
+  } else if (cpu->a != native.a || cpu->x != native.x ||
+    cpu->y != native.y || rom_status != native_status) {
+    panic("Native garbage collection registers differ, "
+      "ROM A=%02x X=%02x Y=%02x SR=%02x, Native A=%02x X=%02x Y=%02x "
+      "SR=%02x", cpu->a, cpu->x, cpu->y, rom_status,
+      native.a, native.x, native.y, native_status);
+  }
+}
+
+
+
+static bool basic_gc_trap(mos6510_t *cpu, mem_t *mem)
+{
+  if (basic_gc_running || basic_compile_running) {
+    return false;
+  }
+  if (! basic_rom_match(mem, BASIC_GC, basic_gc_code,
+    sizeof(basic_gc_code))) {
+    return false;
+  }
+  if (! basic_gc_collect(mem)) {
+    return false;
+  }
+
+  if (basic_gc_checking) {
+    basic_gc_check(cpu, mem);
+  } else {
+    basic_gc_native(cpu, mem);
+  }
+  return true;
+}
+
+
+
+void basic_gc_enable(bool enable)
+{
+  mos6510_trap_set(BASIC_GC, (enable) ? basic_gc_trap : NULL);
+}
+
+
+
+/* Check every native garbage collection against the ROM. */
+void basic_gc_check_enable(bool enable)
+{
+  basic_gc_checking = enable;
+  basic_gc_enable(enable);
+}
+
+
+
+/* Wedges patch CHRGET in RAM, only the stock code is run natively. */
+static bool basic_chrget_stock(mem_t *mem)
+{
+  return memcmp(&mem->ram[BASIC_CHRGET], basic_chrget_code,
+    BASIC_TXTPTR - BASIC_CHRGET) == 0 &&
+    memcmp(&mem->ram[BASIC_TXTPTR + 2],
+    &basic_chrget_code[BASIC_TXTPTR + 2 - BASIC_CHRGET],
+    sizeof(basic_chrget_code) - (BASIC_TXTPTR + 2 - BASIC_CHRGET)) == 0;
+}
+
+
+
+/* Spaces are skipped in one go instead of going around the loop. */
+static bool basic_chrget_trap(mos6510_t *cpu, mem_t *mem)
+{
+  uint16_t address;
+
+  if (basic_compile_running) {
+    return false;
+  }
+  if (! basic_chrget_stock(mem)) {
+    return false;
+  }
+
+  address = basic_word(mem, BASIC_TXTPTR);
+  if (cpu->pc == BASIC_CHRGET) {
+    address++;
+  }
+  while (1) {
+    cpu->a = mem_read(mem, address);
+    if (cpu->a != ' ') {
+      break;
+    }
+    address++;
+  }
+  mem->ram[BASIC_TXTPTR] = address & 0xFF;
+  mem->ram[BASIC_TXTPTR + 1] = address >> 8;
+
+  if (cpu->a >= ':') {
+    cpu->sr.c = 1;
+    cpu->n_result = cpu->z_result = cpu->a - ':';
+  } else {
+    /* Both subtractions together leave A as it was, carry clear only for
+       digits and overflow always clear. */
+    cpu->sr.c = (cpu->a < '0');
+    cpu->sr.v = 0;
+    cpu->n_result = cpu->z_result = cpu->a;
+  }
+
+  mos6510_trap_return(cpu, mem);
+  return true;
+}
+
+
+
+void basic_chrget_enable(bool enable)
+{
+  mos6510_trap_set(BASIC_CHRGET, (enable) ? basic_chrget_trap : NULL);
+  mos6510_trap_set(BASIC_CHRGOT, (enable) ? basic_chrget_trap : NULL);
+}
+
+
+
+/* FLOAT, GIVAYF and FIN on whole numbers all end up with the same exact
+   result, an all zero FAC for 0. */
+static void basic_compile_float(uint8_t *z, int64_t value)
+{
+  uint32_t mantissa;
+  uint8_t exponent;
+
+  memset(&z[BASIC_FACEXP], 0, BASIC_FACSGN - BASIC_FACEXP + 1);
+  z[BASIC_FACOV] = 0;
+  if (value == 0) {
+    return;
+  }
+  if (value < 0) {
+    z[BASIC_FACSGN] = 0xFF;
+    value = -value;
+  }
+  mantissa = value;
+  exponent = 0x80 + 32;
+  while ((mantissa & 0x80000000) == 0) {
+    mantissa <<= 1;
+    exponent--;
+  }
+  z[BASIC_FACEXP] = exponent;
+  z[BASIC_FACHO]  = mantissa >> 24;
+  z[BASIC_FACMOH] = mantissa >> 16;
+  z[BASIC_FACMO]  = mantissa >> 8;
+  z[BASIC_FACLO]  = mantissa;
+}
+
+
+
+/* QINT, rounding towards minus infinity with the rounding byte taken as
+   part of the fraction. Only for FACEXP below $A0. */
+static int64_t basic_compile_floor(const uint8_t *z)
+{
+  uint64_t mantissa;
+  int64_t value;
+  bool fraction;
+  int shift;
+
+  if (z[BASIC_FACEXP] == 0) {
+    return 0;
+  }
+  mantissa = ((uint64_t)z[BASIC_FACHO] << 32) |
+    ((uint64_t)z[BASIC_FACMOH] << 24) | (z[BASIC_FACMO] << 16) |
+    (z[BASIC_FACLO] << 8) | z[BASIC_FACOV];
+  shift = 0xA8 - z[BASIC_FACEXP];
+  if (shift >= 40) {
+    value = 0;
+    fraction = (mantissa != 0);
+  } else {
+    value = mantissa >> shift;
+    fraction = (mantissa & ((1ULL << shift) - 1)) != 0;
+  }
+  if (z[BASIC_FACSGN] & 0x80) {
+    return -value - ((fraction) ? 1 : 0);
+  }
+  return value;
+}
+
+
+
+/* AYINT, or GETADR with the larger exponent limit. Also left to the ROM
+   when the rounding byte could make a difference, some callers ROUND
+   first. */
+static bool basic_compile_integer(const uint8_t *z, uint8_t limit,
+  int64_t *value)
+{
+  if (z[BASIC_FACEXP] >= limit || (z[BASIC_FACOV] & 0x80)) {
+    return false;
+  }
+  *value = basic_compile_floor(z);
+  return true;
+}
+
+
+
+/* MOVFM */
+static void basic_compile_load(uint8_t *z, const uint8_t *m)
+{
+  z[BASIC_FACEXP] = m[0];
+  z[BASIC_FACSGN] = m[1];
+  z[BASIC_FACHO]  = m[1] | 0x80;
+  z[BASIC_FACMOH] = m[2];
+  z[BASIC_FACMO]  = m[3];
+  z[BASIC_FACLO]  = m[4];
+  z[BASIC_FACOV]  = 0;
+}
+
+
+
+/* CONUPK */
+static void basic_compile_unpack(uint8_t *z, const uint8_t *m)
+{
+  z[BASIC_ARGEXP] = m[0];
+  z[BASIC_ARGSGN] = m[1];
+  z[BASIC_ARGHO]  = m[1] | 0x80;
+  z[BASIC_ARGMOH] = m[2];
+  z[BASIC_ARGMO]  = m[3];
+  z[BASIC_ARGLO]  = m[4];
+  z[BASIC_ARISGN] = z[BASIC_ARGSGN] ^ z[BASIC_FACSGN];
+}
+
+
+
+/* MOVMF, rounding first. */
+static bool basic_compile_pack(mos6510_t *r, uint8_t *z, uint8_t *m)
+{
+  if (! basic_fp_round(r, z)) {
+    return false;
+  }
+  m[0] = z[BASIC_FACEXP];
+  m[1] = (z[BASIC_FACSGN] | 0x7F) & z[BASIC_FACHO];
+  m[2] = z[BASIC_FACMOH];
+  m[3] = z[BASIC_FACMO];
+  m[4] = z[BASIC_FACLO];
+  z[BASIC_FACOV] = 0;
+  return true;
+}
+
+
+
+/* Variable value into FAC, integers converted. */
+static void basic_compile_value(uint8_t *z, const basic_op_t *op,
+  const uint8_t *m)
+{
+  if (op->name[0] & 0x80) {
+    basic_compile_float(z, (int16_t)((m[0] << 8) | m[1]));
+  } else {
+    basic_compile_load(z, m);
+  }
+}
+
+
+
+/* FCOMP, FAC against a packed number, 1 if FAC is bigger, 0 if equal and
+   $FF if smaller. A rounding byte of $80 or more counts as one more in the
+   last mantissa byte, without carrying further. */
+static uint8_t basic_compile_fcomp(const uint8_t *z, const uint8_t *m)
+{
+  uint8_t sign;
+  bool carry;
+  int i;
+
+  if (m[0] == 0) {
+    if (z[BASIC_FACEXP] == 0) {
+      return 0;
+    }
+    return (z[BASIC_FACSGN] & 0x80) ? 0xFF : 1;
+  }
+  if ((m[1] ^ z[BASIC_FACSGN]) & 0x80) {
+    return (z[BASIC_FACSGN] & 0x80) ? 0xFF : 1;
+  }
+
+  if (m[0] != z[BASIC_FACEXP]) {
+    carry = (m[0] > z[BASIC_FACEXP]);
+  } else if ((m[1] | 0x80) != z[BASIC_FACHO]) {
+    carry = ((m[1] | 0x80) > z[BASIC_FACHO]);
+  } else if (m[2] != z[BASIC_FACMOH]) {
+    carry = (m[2] > z[BASIC_FACMOH]);
+  } else if (m[3] != z[BASIC_FACMO]) {
+    carry = (m[3] > z[BASIC_FACMO]);
+  } else {
+    i = m[4] - z[BASIC_FACLO] - ((z[BASIC_FACOV] >= 0x80) ? 1 : 0);
+    if ((i & 0xFF) == 0) {
+      return 0;
+    }
+    carry = (i >= 0);
+  }
+
+  sign = z[BASIC_FACSGN];
+  if (carry) {
+    sign ^= 0xFF;
+  }
+  return (sign & 0x80) ? 0xFF : 1;
+}
+
+
+
+/* Next character as CHRGET reads it, spaces skipped. */
+static uint8_t basic_parse_peek(basic_parse_t *ps)
+{
+  while (ps->position < ps->end && ps->mem->ram[ps->position] == ' ') {
+    ps->position++;
+  }
+  return ps->mem->ram[ps->position];
+}
+
+
+
+static uint8_t basic_parse_next(basic_parse_t *ps)
+{
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (c != '\0') {
+    ps->position++;
+  }
+  return c;
+}
+
+
+
+static basic_op_t *basic_parse_emit(basic_op_type_t type)
+{
+  basic_op_t *op;
+
+  op = &basic_compile_op[basic_compile_op_count++];
+  memset(op, 0, sizeof(basic_op_t));
+  op->type = type;
+  return op;
+}
+
+
+
+static inline bool basic_parse_digit(uint8_t c)
+{
+  return c >= '0' && c <= '9';
+}
+
+
+
+static inline bool basic_parse_letter(uint8_t c)
+{
+  return c >= 'A' && c <= 'Z';
+}
+
+
+
+/* PTRGET, numeric variables only and not the clock or status. */
+static bool basic_parse_name(basic_parse_t *ps, uint8_t *name)
+{
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (! basic_parse_letter(c)) {
+    return false;
+  }
+  ps->position++;
+  name[0] = c;
+  name[1] = '\0';
+  while (1) {
+    c = basic_parse_peek(ps);
+    if (! basic_parse_letter(c) && ! basic_parse_digit(c)) {
+      break;
+    }
+    if (name[1] == '\0') {
+      name[1] = c;
+    }
+    ps->position++;
+  }
+
+  if ((name[0] == 'T' && name[1] == 'I') ||
+      (name[0] == 'S' && name[1] == 'T') || c == '$') {
+    return false;
+  }
+  if (c == '%') {
+    name[0] |= 0x80;
+    name[1] |= 0x80;
+    ps->position++;
+  }
+  return true;
+}
+
+
+
+/* FIN, whole numbers only since those come out exact. */
+static bool basic_parse_constant(basic_parse_t *ps, uint8_t *value)
+{
+  uint8_t z[0x100];
+  uint32_t number;
+  int digits;
+  uint8_t c;
+
+  number = 0;
+  for (digits = 0; basic_parse_digit(c = basic_parse_peek(ps)); digits++) {
+    if (digits >= 9) {
+      return false;
+    }
+    number = (number * 10) + (c - '0');
+    ps->position++;
+  }
+  if (c == '.' || c == 'E') {
+    return false;
+  }
+  basic_compile_float(z, number);
+  memcpy(value, &z[BASIC_FACEXP], 5);
+  return true;
+}
+
+
+
+/* LINGET */
+static bool basic_parse_line(basic_parse_t *ps, uint16_t *number)
+{
+  uint32_t line;
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (! basic_parse_digit(c)) {
+    return false; /* Line 0 to the ROM, rare enough. */
+  }
+  line = 0;
+  while (basic_parse_digit(c = basic_parse_peek(ps))) {
+    if (line >= 6400) {
+      return false; /* ?SYNTAX ERROR */
+    }
+    line = (line * 10) + (c - '0');
+    ps->position++;
+  }
+  *number = line;
+  return true;
+}
+
+
+
+static bool basic_parse_expression(basic_parse_t *ps, int precedence);
+
+/* One operand of FRMEVL, with unary minus and NOT applied the way EVAL
+   does, binding everything above their own precedence. */
+static bool basic_parse_operand(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  basic_op_type_t type;
+  uint8_t name[2];
+  uint8_t value[5];
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (basic_parse_digit(c)) {
+    if (! basic_parse_constant(ps, value)) {
+      return false;
+    }
+    op = basic_parse_emit(BASIC_OP_CONSTANT);
+    memcpy(op->value, value, sizeof(value));
+    return true;
+  }
+
+  if (basic_parse_letter(c)) {
+    if (! basic_parse_name(ps, name)) {
+      return false;
+    }
+    if (basic_parse_peek(ps) == '(') {
+      ps->position++;
+      if (! basic_parse_expression(ps, 0) || basic_parse_next(ps) != ')') {
+        return false;
+      }
+      type = BASIC_OP_ELEMENT;
+    } else {
+      type = (name[0] & 0x80) ? BASIC_OP_INTEGER : BASIC_OP_FLOAT;
+    }
+    op = basic_parse_emit(type);
+    op->name[0] = name[0];
+    op->name[1] = name[1];
+    return true;
+  }
+
+  ps->position++;
+  switch (c) {
+  case BASIC_TOKEN_PLUS:
+    return basic_parse_operand(ps);
+
+  case BASIC_TOKEN_MINUS:
+    type = BASIC_OP_NEGATE;
+    if (! basic_parse_expression(ps, 0x7D)) {
+      return false;
+    }
+    break;
+
+  case BASIC_TOKEN_NOT:
+    type = BASIC_OP_NOT;
+    if (! basic_parse_expression(ps, 0x5A)) {
+      return false;
+    }
+    break;
+
+  case '(':
+    return basic_parse_expression(ps, 0) && basic_parse_next(ps) == ')';
+
+  case BASIC_TOKEN_SGN:
+  case BASIC_TOKEN_INT:
+  case BASIC_TOKEN_ABS:
+  case BASIC_TOKEN_PEEK:
+    if (c == BASIC_TOKEN_SGN) {
+      type = BASIC_OP_SGN;
+    } else if (c == BASIC_TOKEN_INT) {
+      type = BASIC_OP_INT;
+    } else if (c == BASIC_TOKEN_ABS) {
+      type = BASIC_OP_ABS;
+    } else {
+      type = BASIC_OP_PEEK;
+    }
+    if (basic_parse_next(ps) != '(' || ! basic_parse_expression(ps, 0) ||
+        basic_parse_next(ps) != ')') {
+      return false;
+    }
+    break;
+
+  default:
+    return false; /* Strings, other functions, pi and so on. */
+  }
+
+  basic_parse_emit(type);
+  return true;
+}
+
+
+
+/* FRMEVL, taking operators binding tighter than the precedence given.
+   Relational operators combine into one compare mask, > = < as bits. */
+static bool basic_parse_expression(basic_parse_t *ps, int precedence)
+{
+  basic_op_t *op;
+  basic_op_type_t type;
+  int operator;
+  uint8_t mask;
+  uint8_t c;
+
+  if (++ps->nesting > BASIC_COMPILE_NESTING) {
+    return false;
+  }
+  if (! basic_parse_operand(ps)) {
+    return false;
+  }
+
+  while (1) {
+    c = basic_parse_peek(ps);
+    if (c >= BASIC_TOKEN_GREATER && c <= BASIC_TOKEN_LESS) {
+      type = BASIC_OP_COMPARE;
+      operator = 0x64;
+    } else if (c == BASIC_TOKEN_PLUS || c == BASIC_TOKEN_MINUS) {
+      type = (c == BASIC_TOKEN_PLUS) ? BASIC_OP_ADD : BASIC_OP_SUBTRACT;
+      operator = 0x79;
+    } else if (c == BASIC_TOKEN_MULTIPLY || c == BASIC_TOKEN_DIVIDE) {
+      type = (c == BASIC_TOKEN_MULTIPLY) ? BASIC_OP_MULTIPLY : BASIC_OP_DIVIDE;
+      operator = 0x7B;
+    } else if (c == BASIC_TOKEN_AND) {
+      type = BASIC_OP_AND;
+      operator = 0x50;
+    } else if (c == BASIC_TOKEN_OR) {
+      type = BASIC_OP_OR;
+      operator = 0x46;
+    } else if (c == BASIC_TOKEN_POWER) {
+      return false; /* Goes through LOG and EXP. */
+    } else {
+      break;
+    }
+    if (operator <= precedence) {
+      break;
+    }
+
+    mask = 0;
+    if (type == BASIC_OP_COMPARE) {
+      while (c >= BASIC_TOKEN_GREATER && c <= BASIC_TOKEN_LESS) {
+        if (mask & (1 << (c - BASIC_TOKEN_GREATER))) {
+          return false; /* ?SYNTAX ERROR */
+        }
+        mask |= 1 << (c - BASIC_TOKEN_GREATER);
+        ps->position++;
+        c = basic_parse_peek(ps);
+      }
+    } else {
+      ps->position++;
+    }
+
+    if (ps->depth >= BASIC_COMPILE_STACK) {
+      return false;
+    }
+    basic_parse_emit(BASIC_OP_PUSH);
+    ps->depth++;
+    if (! basic_parse_expression(ps, operator)) {
+      return false;
+    }
+    op = basic_parse_emit(type);
+    op->name[0] = mask;
+    ps->depth--;
+  }
+
+  ps->nesting--;
+  return true;
+}
+
+
+
+/* Statements end on a colon or the end of the line, with TXTPTR left on
+   it for NEWSTT. */
+static bool basic_parse_end(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (c != ':' && c != '\0') {
+    return false;
+  }
+  op = basic_parse_emit(BASIC_OP_END);
+  op->address = ps->position;
+  return true;
+}
+
+
+
+static bool basic_parse_let(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  basic_op_type_t type;
+  uint8_t name[2];
+
+  if (! basic_parse_name(ps, name)) {
+    return false;
+  }
+  type = BASIC_OP_STORE;
+  if (basic_parse_peek(ps) == '(') {
+    ps->position++;
+    if (! basic_parse_expression(ps, 0) || basic_parse_next(ps) != ')') {
+      return false;
+    }
+    op = basic_parse_emit(BASIC_OP_TARGET);
+    op->name[0] = name[0];
+    op->name[1] = name[1];
+    type = BASIC_OP_STORE_ELEMENT;
+  }
+  if (basic_parse_next(ps) != BASIC_TOKEN_EQUAL ||
+      ! basic_parse_expression(ps, 0)) {
+    return false;
+  }
+  op = basic_parse_emit(type);
+  op->name[0] = name[0];
+  op->name[1] = name[1];
+  return basic_parse_end(ps);
+}
+
+
+
+/* A false condition skips the rest of the line. When true a line number
+   is jumped to directly, anything else is started through GONE. */
+static bool basic_parse_if(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  uint16_t number;
+  uint16_t then;
+  uint8_t c;
+
+  if (! basic_parse_expression(ps, 0)) {
+    return false;
+  }
+  c = basic_parse_peek(ps);
+  if (c == BASIC_TOKEN_GOTO) {
+    op = basic_parse_emit(BASIC_OP_IF);
+    op->address = ps->end;
+    op = basic_parse_emit(BASIC_OP_GONE);
+    op->address = ps->position - 1;
+    return true;
+  } else if (c != BASIC_TOKEN_THEN) {
+    return false;
+  }
+
+  then = ps->position++;
+  op = basic_parse_emit(BASIC_OP_IF);
+  op->address = ps->end;
+  if (basic_parse_digit(basic_parse_peek(ps))) {
+    if (! basic_parse_line(ps, &number)) {
+      return false;
+    }
+    op = basic_parse_emit(BASIC_OP_GOTO);
+    op->address = number;
+  } else {
+    op = basic_parse_emit(BASIC_OP_GONE);
+    op->address = then;
+  }
+  return true;
+}
+
+
+
+static bool basic_parse_next_statement(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  uint8_t name[2];
+  int count;
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (c == ':' || c == '\0') {
+    basic_parse_emit(BASIC_OP_NEXT); /* The innermost loop. */
+    return basic_parse_end(ps);
+  }
+
+  for (count = 0; count < BASIC_COMPILE_NEXT; count++) {
+    if (! basic_parse_name(ps, name) || (name[0] & 0x80) ||
+        basic_parse_peek(ps) == '(') {
+      return false;
+    }
+    op = basic_parse_emit(BASIC_OP_NEXT);
+    op->name[0] = name[0];
+    op->name[1] = name[1];
+    if (basic_parse_peek(ps) != ',') {
+      return basic_parse_end(ps);
+    }
+    ps->position++;
+  }
+  return false;
+}
+
+
+
+/* Numeric LET, IF, GOTO, POKE and NEXT are compiled, the rest is left to
+   the ROM. FOR and GOSUB are only run once per loop or call, and NEXT is
+   compiled against the stack entries the ROM makes for FOR. */
+static bool basic_parse_statement(basic_parse_t *ps)
+{
+  basic_op_t *op;
+  uint16_t number;
+  uint8_t c;
+
+  c = basic_parse_peek(ps);
+  if (basic_parse_letter(c)) {
+    return basic_parse_let(ps);
+  }
+
+  ps->position++;
+  switch (c) {
+  case BASIC_TOKEN_LET:
+    return basic_parse_let(ps);
+
+  case BASIC_TOKEN_IF:
+    return basic_parse_if(ps);
+
+  case BASIC_TOKEN_GOTO:
+    if (! basic_parse_line(ps, &number)) {
+      return false;
+    }
+    op = basic_parse_emit(BASIC_OP_GOTO);
+    op->address = number;
+    return true;
+
+  case BASIC_TOKEN_POKE:
+    if (! basic_parse_expression(ps, 0)) {
+      return false;
+    }
+    basic_parse_emit(BASIC_OP_ADDRESS);
+    if (basic_parse_next(ps) != ',' || ! basic_parse_expression(ps, 0)) {
+      return false;
+    }
+    basic_parse_emit(BASIC_OP_POKE);
+    return basic_parse_end(ps);
+
+  case BASIC_TOKEN_NEXT:
+    return basic_parse_next_statement(ps);
+
+  default:
+    return false;
+  }
+}
+
+
+
+static void basic_compile_flush(void)
+{
+  int i;
+
+  for (i = 0; i < basic_compile_count; i++) {
+    basic_compile_index[basic_compile_statement[i].txtptr] = 0;
+  }
+  basic_compile_count = 0;
+  basic_compile_op_count = 0;
+  basic_compile_text_count = 0;
+}
+
+
+
+/* Writes to the text are caught through the code generation of its pages,
+   the last one shared with the variables gets compared byte by byte. */
+static void basic_compile_mark(mem_t *mem, basic_statement_t *s)
+{
+  int first;
+  int page;
+
+  first = s->start >> 8;
+  for (page = first; page <= (s->start + s->length - 1) >> 8; page++) {
+    mem_code_mark(mem, page << 8);
+    s->generation[page - first] = mem->code_generation[page];
+  }
+}
+
+
+
+static bool basic_compile_valid(mem_t *mem, basic_statement_t *s)
+{
+  bool changed;
+  int first;
+  int page;
+
+  changed = false;
+  first = s->start >> 8;
+  for (page = first; page <= (s->start + s->length - 1) >> 8; page++) {
+    if (mem->code_generation[page] != s->generation[page - first]) {
+      changed = true;
+    }
+  }
+  if (! changed) {
+    return true;
+  }
+  if (memcmp(&mem->ram[s->start], &basic_compile_text[s->text],
+    s->length) != 0) {
+    return false;
+  }
+  basic_compile_mark(mem, s);
+  return true;
+}
+
+
+
+/* Compile the statement after TXTPTR, only in the program text and below
+   the ROMs. Those that can not be compiled are remembered as well. */
+static basic_statement_t *basic_compile_new(mem_t *mem, uint16_t txtptr)
+{
+  basic_statement_t *s;
+  basic_parse_t ps;
+  uint16_t start;
+  uint16_t end;
+
+  start = txtptr + 1;
+  if (start < basic_word(mem, BASIC_TXTTAB) || start >= 0xA000) {
+    return NULL;
+  }
+  for (end = start; mem->ram[end] != '\0'; end++) {
+    if (end - start >= BASIC_COMPILE_LINE - 1 || end >= 0x9FFF) {
+      return NULL;
+    }
+  }
+
+  if (basic_compile_count >= BASIC_COMPILE_MAX ||
+      basic_compile_op_count > BASIC_COMPILE_OPS - (BASIC_COMPILE_LINE * 2) ||
+      basic_compile_text_count > BASIC_COMPILE_TEXT - BASIC_COMPILE_LINE) {
+    basic_compile_flush();
+  }
+
+  s = &basic_compile_statement[basic_compile_count];
+  s->txtptr = txtptr;
+  s->start = start;
+  s->length = end + 1 - start;
+  s->text = basic_compile_text_count;
+  memcpy(&basic_compile_text[s->text], &mem->ram[start], s->length);
+  basic_compile_text_count += s->length;
+  basic_compile_mark(mem, s);
+
+  ps.mem = mem;
+  ps.position = start;
+  ps.end = end;
+  ps.depth = 0;
+  ps.nesting = 0;
+  s->op = basic_compile_op_count;
+  if (! basic_parse_statement(&ps)) {
+    basic_compile_op_count = s->op;
+    s->op = -1;
+  }
+
+  basic_compile_count++;
+  basic_compile_index[txtptr] = basic_compile_count;
+  return s;
+}
+
+
+
+/* Simple variable entry, remembered in the operation for next time. Not
+   found is left to the ROM, which creates it. */
+static uint16_t basic_compile_variable(mem_t *mem, basic_op_t *op)
+{
+  uint16_t vartab;
+  uint16_t arytab;
+  uint16_t address;
+
+  vartab = basic_word(mem, BASIC_VARTAB);
+  arytab = basic_word(mem, BASIC_ARYTAB);
+  if (arytab < vartab || arytab > 0xA000) {
+    return 0;
+  }
+
+  address = op->address;
+  if (address >= vartab && address < arytab &&
+      (address - vartab) % BASIC_VAR_SIZE == 0 &&
+      mem->ram[address] == op->name[0] &&
+      mem->ram[address + 1] == op->name[1]) {
+    return address;
+  }
+  for (address = vartab; address + BASIC_VAR_SIZE <= arytab;
+    address += BASIC_VAR_SIZE) {
+    if (mem->ram[address] == op->name[0] &&
+        mem->ram[address + 1] == op->name[1]) {
+      op->address = address;
+      return address;
+    }
+  }
+  return 0;
+}
+
+
+
+/* Element of a one dimensional array. Arrays to be created, more
+   dimensions and bad subscripts are left to the ROM. */
+static uint16_t basic_compile_element(mem_t *mem, const basic_op_t *op,
+  int64_t index)
+{
+  uint16_t address;
+  uint16_t strend;
+  uint16_t size;
+  int element;
+  int i;
+
+  address = basic_word(mem, BASIC_ARYTAB);
+  strend = basic_word(mem, BASIC_STREND);
+  if (strend > 0xA000) {
+    return 0;
+  }
+  for (i = 0; i < BASIC_COMPILE_ARRAYS && address + 7 <= strend; i++) {
+    size = mem->ram[address + 2] + (mem->ram[address + 3] * 256);
+    if (mem->ram[address] == op->name[0] &&
+        mem->ram[address + 1] == op->name[1]) {
+      element = (op->name[0] & 0x80) ? 2 : 5;
+      if (mem->ram[address + 4] != 1 || index >=
+          (mem->ram[address + 5] * 256) + mem->ram[address + 6] ||
+          7 + ((index + 1) * element) > size || size > strend - address) {
+        return 0;
+      }
+      return address + 7 + (index * element);
+    }
+    if (size == 0 || size > strend - address) {
+      return 0;
+    }
+    address += size;
+  }
+  return 0;
+}
+
+
+
+/* INTIDX */
+static bool basic_compile_subscript(const uint8_t *z, int64_t *index)
+{
+  if (z[BASIC_FACSGN] & 0x80) {
+    return false;
+  }
+  return basic_compile_integer(z, 0x90, index);
+}
+
+
+
+/* Operator entry, ROUND and push FAC with its sign, then pop into ARG. */
+static bool basic_compile_push(basic_run_t *run)
+{
+  uint8_t *z = run->z;
+  uint8_t *e;
+
+  if (! basic_fp_round(&run->r, z)) {
+    return false;
+  }
+  e = run->stack[run->depth++];
+  memcpy(e, &z[BASIC_FACEXP], 5);
+  e[5] = z[BASIC_FACSGN];
+  return true;
+}
+
+
+
+static void basic_compile_pop(basic_run_t *run)
+{
+  uint8_t *z = run->z;
+  uint8_t *e;
+
+  e = run->stack[--run->depth];
+  memcpy(&z[BASIC_ARGEXP], e, 5);
+  z[BASIC_ARGSGN] = e[5];
+  z[BASIC_ARISGN] = z[BASIC_ARGSGN] ^ z[BASIC_FACSGN];
+}
+
+
+
+/* MOVFA */
+static void basic_compile_movfa(uint8_t *z)
+{
+  memcpy(&z[BASIC_FACEXP], &z[BASIC_ARGEXP],
+    BASIC_ARGSGN - BASIC_ARGEXP + 1);
+  z[BASIC_FACOV] = 0;
+}
+
+
+
+/* FADDT, which is just a copy of ARG when FAC is zero. */
+static bool basic_compile_add(basic_run_t *run)
+{
+  if (run->z[BASIC_FACEXP] == 0) {
+    basic_compile_movfa(run->z);
+    return true;
+  }
+  return basic_fp_add(&run->r, run->z);
+}
+
+
+
+/* DOREL, ARG on the left compared to FAC on the right gives -1 or 0. */
+static void basic_compile_compare(uint8_t *z, uint8_t mask)
+{
+  uint8_t m[5];
+  uint8_t result;
+
+  z[BASIC_ARGHO] = (z[BASIC_ARGSGN] | 0x7F) & z[BASIC_ARGHO];
+  memcpy(m, &z[BASIC_ARGEXP], sizeof(m));
+  result = basic_compile_fcomp(z, m);
+  if (result == 1) {
+    result = 4; /* < */
+  } else if (result == 0) {
+    result = 2; /* = */
+  } else {
+    result = 1; /* > */
+  }
+  basic_compile_float(z, (result & mask) ? -1 : 0);
+}
+
+
+
+/* ANDOP and OROP, both operands as 16 bit integers. */
+static bool basic_compile_logic(uint8_t *z, bool or)
+{
+  int64_t right;
+  int64_t left;
+
+  if (! basic_compile_integer(z, 0x90, &right)) {
+    return false;
+  }
+  basic_compile_movfa(z);
+  if (! basic_compile_integer(z, 0x90, &left)) {
+    return false;
+  }
+  basic_compile_float(z, (or) ? (left | right) : (left & right));
+  return true;
+}
+
+
+
+/* The first side effect, zero page goes back with FAC and ARG as the ROM
+   would have left them. */
+static void basic_compile_commit(basic_run_t *run, mem_t *mem)
+{
+  if (! run->committed) {
+    memcpy(&mem->ram[0x02], &run->z[0x02], sizeof(run->z) - 0x02);
+    run->committed = true;
+  }
+}
+
+
+
+static void basic_compile_leave(basic_run_t *run, mos6510_t *cpu,
+  mem_t *mem, uint16_t txtptr, uint16_t pc)
+{
+  basic_compile_commit(run, mem);
+  mem->ram[BASIC_TXTPTR] = txtptr & 0xFF;
+  mem->ram[BASIC_TXTPTR + 1] = txtptr >> 8;
+  cpu->pc = pc;
+}
+
+
+
+/* LET, into a variable or element found before the expression. */
+static bool basic_compile_store(basic_run_t *run, mem_t *mem,
+  const basic_op_t *op, uint16_t address)
+{
+  int64_t value;
+  uint8_t m[5];
+  int i;
+
+  if (op->name[0] & 0x80) {
+    if (! basic_compile_integer(run->z, 0x90, &value)) {
+      return false;
+    }
+    basic_compile_commit(run, mem);
+    mem_write(mem, address, (value >> 8) & 0xFF);
+    mem_write(mem, address + 1, value & 0xFF);
+  } else {
+    if (! basic_compile_pack(&run->r, run->z, m)) {
+      return false;
+    }
+    basic_compile_commit(run, mem);
+    for (i = 0; i < 5; i++) {
+      mem_write(mem, address + i, m[i]);
+    }
+  }
+  return true;
+}
+
+
+
+/* GOTO, searching from the next line when going forward like the ROM,
+   through the line index. */
+static bool basic_compile_goto(mem_t *mem, const basic_statement_t *s,
+  uint16_t number, uint16_t *address)
+{
+  int position;
+
+  if (! basic_line_valid || basic_line_changed(mem)) {
+    if (! basic_line_build(mem)) {
+      return false;
+    }
+  }
+  position = 0;
+  if (number > basic_word(mem, BASIC_CURLIN)) {
+    position = basic_line_position(s->start + s->length);
+    if (position < 0) {
+      return false;
+    }
+  }
+  position = basic_line_find(position, number);
+  if (position >= basic_line_count ||
+      basic_line_number[position] != number) {
+    return false; /* ?UNDEF'D STATEMENT ERROR */
+  }
+  *address = basic_line_address[position];
+  return true;
+}
+
+
+
+/* NEXT, for each variable in turn finding its FOR entry on the stack,
+   adding STEP and comparing against TO. All is worked out before any of
+   it is stored, so the ROM can still take over. */
+static bool basic_compile_next(basic_run_t *run, mos6510_t *cpu,
+  mem_t *mem, basic_op_t *op)
+{
+  uint8_t value[BASIC_COMPILE_NEXT][5];
+  uint16_t variable[BASIC_COMPILE_NEXT];
+  uint16_t address;
+  uint8_t *frame;
+  uint8_t *z;
+  bool again;
+  int count;
+  int x;
+  int i;
+
+  z = run->z;
+  x = cpu->sp;
+  again = false;
+  for (count = 0; op->type == BASIC_OP_NEXT; op++) {
+    address = 0;
+    if (op->name[0] != '\0') {
+      address = basic_compile_variable(mem, op);
+      if (address == 0) {
+        return false;
+      }
+      address += 2;
+    }
+
+    /* FNDFOR */
+    while (1) {
+      if (x + BASIC_FOR_SIZE > 0xFF) {
+        return false;
+      }
+      frame = &mem->ram[MEM_PAGE_STACK + x + 1];
+      if (frame[0] != BASIC_TOKEN_FOR) {
+        return false; /* ?NEXT WITHOUT FOR ERROR */
+      }
+      if (op->name[0] == '\0') {
+        address = frame[1] + (frame[2] * 256);
+        break;
+      }
+      if (frame[1] + (frame[2] * 256) == address) {
+        break;
+      }
+      x += BASIC_FOR_SIZE;
+    }
+    if (address >= 0xA000 - 5) {
+      return false;
+    }
+
+    basic_compile_load(z, &frame[3]);
+    z[BASIC_FACSGN] = frame[8];
+    basic_compile_unpack(z, &mem->ram[address]);
+    if (! basic_compile_add(run) ||
+        ! basic_compile_pack(&run->r, z, value[count])) {
+      return false;
+    }
+    variable[count++] = address;
+
+    if (basic_compile_fcomp(z, &frame[9]) != frame[8]) {
+      again = true;
+      break;
+    }
+    x += BASIC_FOR_SIZE;
+  }
+
+  basic_compile_commit(run, mem);
+  for (i = 0; i < count; i++) {
+    mem_write(mem, variable[i], value[i][0]);
+    mem_write(mem, variable[i] + 1, value[i][1]);
+    mem_write(mem, variable[i] + 2, value[i][2]);
+    mem_write(mem, variable[i] + 3, value[i][3]);
+    mem_write(mem, variable[i] + 4, value[i][4]);
+  }
+  cpu->sp = x;
+  if (again) {
+    mem->ram[BASIC_CURLIN] = frame[14];
+    mem->ram[BASIC_CURLIN + 1] = frame[15];
+    basic_compile_leave(run, cpu, mem, frame[17] + (frame[16] * 256),
+      BASIC_NEWSTT);
+  } else {
+    basic_compile_leave(run, cpu, mem, op->address, BASIC_NEWSTT);
+  }
+  return true;
+}
+
+
+
+/* Run a compiled statement on a copy of zero page. Anything the ROM would
+   raise an error on, or that is not known yet, returns false before the
+   first side effect so the ROM can run the statement instead. */
+static bool basic_compile_execute(mos6510_t *cpu, mem_t *mem,
+  basic_statement_t *s)
+{
+  basic_run_t run;
+  basic_op_t *op;
+  uint16_t address;
+  int64_t value;
+  uint8_t *z;
+
+  memset(&run.r, 0, sizeof(run.r));
+  memcpy(run.z, mem->ram, sizeof(run.z));
+  run.depth = 0;
+  run.committed = false;
+  z = run.z;
+
+  for (op = &basic_compile_op[s->op]; ; op++) {
+    switch (op->type) {
+    case BASIC_OP_CONSTANT:
+      memcpy(&z[BASIC_FACEXP], op->value, sizeof(op->value));
+      z[BASIC_FACSGN] = 0;
+      z[BASIC_FACOV] = 0;
+      break;
+
+    case BASIC_OP_FLOAT:
+    case BASIC_OP_INTEGER:
+      address = basic_compile_variable(mem, op);
+      if (address == 0) {
+        return false;
+      }
+      basic_compile_value(z, op, &mem->ram[address + 2]);
+      break;
+
+    case BASIC_OP_ELEMENT:
+      if (! basic_compile_subscript(z, &value)) {
+        return false;
+      }
+      address = basic_compile_element(mem, op, value);
+      if (address == 0) {
+        return false;
+      }
+      basic_compile_value(z, op, &mem->ram[address]);
+      break;
+
+    case BASIC_OP_PUSH:
+      if (! basic_compile_push(&run)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_ADD:
+      basic_compile_pop(&run);
+      if (! basic_compile_add(&run)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_SUBTRACT:
+      basic_compile_pop(&run);
+      z[BASIC_FACSGN] ^= 0xFF;
+      z[BASIC_ARISGN] = z[BASIC_FACSGN] ^ z[BASIC_ARGSGN];
+      if (! basic_compile_add(&run)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_MULTIPLY:
+      basic_compile_pop(&run);
+      if (z[BASIC_FACEXP] != 0 && ! basic_fp_multiply(&run.r, z)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_DIVIDE:
+      basic_compile_pop(&run);
+      if (z[BASIC_FACEXP] == 0 || ! basic_fp_divide(&run.r, z)) {
+        return false; /* ?DIVISION BY ZERO ERROR and the like. */
+      }
+      break;
+
+    case BASIC_OP_COMPARE:
+      basic_compile_pop(&run);
+      basic_compile_compare(z, op->name[0]);
+      break;
+
+    case BASIC_OP_AND:
+    case BASIC_OP_OR:
+      basic_compile_pop(&run);
+      if (! basic_compile_logic(z, op->type == BASIC_OP_OR)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_NEGATE:
+      if (z[BASIC_FACEXP] != 0) {
+        z[BASIC_FACSGN] ^= 0xFF;
+      }
+      break;
+
+    case BASIC_OP_NOT:
+      if (! basic_compile_integer(z, 0x90, &value)) {
+        return false;
+      }
+      basic_compile_float(z, ~value);
+      break;
+
+    case BASIC_OP_SGN:
+      if (z[BASIC_FACEXP] == 0) {
+        basic_compile_float(z, 0);
+      } else {
+        basic_compile_float(z, (z[BASIC_FACSGN] & 0x80) ? -1 : 1);
+      }
+      break;
+
+    case BASIC_OP_INT:
+      if (z[BASIC_FACEXP] < 0xA0) {
+        basic_compile_float(z, basic_compile_floor(z));
+      }
+      break;
+
+    case BASIC_OP_ABS:
+      z[BASIC_FACSGN] >>= 1;
+      break;
+
+    case BASIC_OP_PEEK:
+      if ((z[BASIC_FACSGN] & 0x80) ||
+          ! basic_compile_integer(z, 0x91, &value) ||
+          mem->read_page[value >> 8] == NULL) {
+        return false; /* Reading I/O twice could change it. */
+      }
+      basic_compile_float(z, mem_read(mem, value));
+      break;
+
+    case BASIC_OP_TARGET:
+      if (! basic_compile_subscript(z, &value)) {
+        return false;
+      }
+      run.target = basic_compile_element(mem, op, value);
+      if (run.target == 0) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_STORE:
+      address = basic_compile_variable(mem, op);
+      if (address == 0 || ! basic_compile_store(&run, mem, op, address + 2)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_STORE_ELEMENT:
+      if (! basic_compile_store(&run, mem, op, run.target)) {
+        return false;
+      }
+      break;
+
+    case BASIC_OP_ADDRESS:
+      if ((z[BASIC_FACSGN] & 0x80) ||
+          ! basic_compile_integer(z, 0x91, &value)) {
+        return false;
+      }
+      run.address = value;
+      break;
+
+    case BASIC_OP_POKE:
+      /* Zero page pointers are left to the ROM, besides the port. */
+      if ((z[BASIC_FACSGN] & 0x80) ||
+          ! basic_compile_integer(z, 0x90, &value) || value > 0xFF ||
+          (run.address >= 0x02 && run.address < MEM_PAGE_STACK)) {
+        return false;
+      }
+      basic_compile_commit(&run, mem);
+      mem_write(mem, run.address, value);
+      break;
+
+    case BASIC_OP_IF:
+      if (z[BASIC_FACEXP] == 0) {
+        basic_compile_leave(&run, cpu, mem, op->address, BASIC_NEWSTT);
+        return true;
+      }
+      break;
+
+    case BASIC_OP_GOTO:
+      if (! basic_compile_goto(mem, s, op->address, &address)) {
+        return false;
+      }
+      basic_compile_leave(&run, cpu, mem, address - 1, BASIC_NEWSTT);
+      return true;
+
+    case BASIC_OP_GONE:
+      basic_compile_leave(&run, cpu, mem, op->address, BASIC_GONE);
+      return true;
+
+    case BASIC_OP_NEXT:
+      return basic_compile_next(&run, cpu, mem, op);
+
+    case BASIC_OP_END:
+      basic_compile_leave(&run, cpu, mem, op->address, BASIC_NEWSTT);
+      return true;
+    }
+  }
+}
+
+
+
+/* Run the ROM on until it starts the next statement. */
+static bool basic_compile_rom(mos6510_t *cpu, mem_t *mem, uint64_t *used)
+{
+  uint8_t cycles;
+  int steps;
+
+  cycles = cpu->cycles;
+  for (steps = 0; cpu->pc != BASIC_NEWSTT; steps++) {
+    if (steps >= BASIC_COMPILE_STEPS) {
+      cpu->cycles = cycles;
+      return false;
+    }
+    cpu->cycles = 0;
+    mos6510_execute(cpu, mem);
+    *used += cpu->cycles;
+  }
+  cpu->cycles = cycles;
+  return true;
+}
+
+
+
+static uint64_t basic_compile_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+
+
+/* Temporaries the ROM leaves behind and compiled statements do not keep
+   up, being the index pointers, the multiply result, the variable
+   pointers, FAC and ARG. Also what is left from the last expression, the
+   line number read and the variable or line found, which the ROM always
+   sets again before looking at them: VALTYP and INTFLG, LINNUM from
+   LINGET and GETADR, VARNAM from PTRGET, the FRMEVL operator at OPPTR
+   and OPMASK, and LOWTR from PTRGET and FNDLIN. The stack below the
+   stack pointer is scratch space too. */
+static bool basic_compile_scratch(uint16_t address, uint8_t sp)
+{
+  if (address < MEM_PAGE_STACK) {
+    return address == BASIC_VALTYP || address == BASIC_VALTYP + 1 ||
+      address == BASIC_LINNUM || address == BASIC_LINNUM + 1 ||
+      (address >= BASIC_INDEX && address <= BASIC_RESLO + 1) ||
+      (address >= BASIC_VARNAM && address <= BASIC_OPPTR + 2) ||
+      address == BASIC_LOWTR || address == BASIC_LOWTR + 1 ||
+      (address >= BASIC_FACEXP && address <= BASIC_FACOV);
+  }
+  return address <= MEM_PAGE_STACK + sp;
+}
+
+
+
+/* Run both the compiled statement and the ROM from the same state and
+   compare all of RAM afterwards, screen included, carrying on with the ROM
+   result. A statement after THEN is finished by the ROM in both cases. */
+static bool basic_compile_check(mos6510_t *cpu, mem_t *mem,
+  basic_statement_t *s)
+{
+  mos6510_t start;
+  mos6510_t native;
+  uint64_t clock;
+  uint16_t line;
+  uint8_t value;
+  bool finished;
+  int differences;
+  int first;
+  int i;
+
+  start = *cpu;
+  line = basic_word(mem, BASIC_CURLIN);
+  memcpy(basic_compile_ram, mem->ram, sizeof(basic_compile_ram));
+  clock = basic_compile_clock();
+  if (! basic_compile_execute(cpu, mem, s)) {
+    return false;
+  }
+  basic_compile_running = true;
+  finished = basic_compile_rom(cpu, mem, &basic_compile_cycles[0]);
+  basic_compile_time[0] += basic_compile_clock() - clock;
+  native = *cpu;
+
+  /* Swap in the starting RAM, keeping the compiled result for comparing. */
+  for (i = 0; i <= UINT16_MAX; i++) {
+    value = mem->ram[i];
+    mem->ram[i] = basic_compile_ram[i];
+    basic_compile_ram[i] = value;
+  }
+  mem_code_flush(mem);
+  *cpu = start;
+  clock = basic_compile_clock();
+  finished = basic_compile_rom(cpu, mem, &basic_compile_cycles[1]) &&
+    finished;
+  basic_compile_time[1] += basic_compile_clock() - clock;
+  basic_compile_running = false;
+  basic_compile_checked++;
+
+  if (! finished) {
+    panic("Compiled BASIC line %u did not get to the next statement", line);
+    return true;
+  }
+  if (cpu->sp != native.sp) {
+    panic("Compiled BASIC line %u stack differs, ROM SP=%02x, "
+      "Compiled SP=%02x", line, cpu->sp, native.sp);
+    return true;
+  }
+
+  differences = 0;
+  first = -1;
+  for (i = 0; i <= UINT16_MAX; i++) {
+    if (mem->ram[i] != basic_compile_ram[i] &&
+        ! basic_compile_scratch(i, cpu->sp)) {
+      if (first < 0) {
+        first = i;
+      }
+      differences++;
+    }
+  }
+  if (differences > 0) {
+    panic("Compiled BASIC line %u differs in %d bytes, first at $%04x "
+      "(ROM %02x, Compiled %02x)", line, differences, first,
+      mem->ram[first], basic_compile_ram[first]);
+  }
+  return true;
+}
+
+
+
+static bool basic_compile_trap(mos6510_t *cpu, mem_t *mem)
+{
+  basic_statement_t *s;
+  uint16_t txtptr;
+
+  if (basic_compile_running) {
+    return false;
+  }
+  if (! basic_rom_match(mem, BASIC_GONE, basic_gone_code,
+    sizeof(basic_gone_code)) || ! basic_chrget_stock(mem)) {
+    return false;
+  }
+  if (mem->ram[BASIC_CURLIN + 1] == 0xFF) {
+    return false; /* Direct mode. */
+  }
+
+  txtptr = basic_word(mem, BASIC_TXTPTR);
+  s = NULL;
+  if (basic_compile_index[txtptr] != 0) {
+    s = &basic_compile_statement[basic_compile_index[txtptr] - 1];
+    if (! basic_compile_valid(mem, s)) {
+      s = NULL;
+    }
+  }
+  if (s == NULL) {
+    s = basic_compile_new(mem, txtptr);
+  }
+  if (s == NULL || s->op < 0) {
+    return false;
+  }
+
+  if (basic_compile_checking) {
+    return basic_compile_check(cpu, mem, s);
+  }
+  return basic_compile_execute(cpu, mem, s);
+}
+
+
+
+void basic_compile_enable(bool enable)
+{
+  basic_compile_flush();
+  mos6510_trap_set(BASIC_GONE, (enable) ? basic_compile_trap : NULL);
+}
+
+
+
+/* Check every compiled statement against the ROM. */
+void basic_compile_check_enable(bool enable)
+{
+  basic_compile_checking = enable;
+  basic_compile_enable(enable);
+}
+
+
+
+/* Time per statement for the compiled code and the ROM, from the checks.
+   The compiled side includes the ROM finishing what it left over. */
+void basic_compile_report(FILE *fh)
+{
+  const char *name[2] = {"Compiled", "ROM"};
+  int i;
+
+  fprintf(fh, "BASIC Compile Check: %llu statements\n",
+    (unsigned long long)basic_compile_checked);
+  if (basic_compile_checked == 0) {
+    return;
+  }
+  for (i = 0; i < 2; i++) {
+    fprintf(fh, "  %-8s %8llu ns, %6llu ROM cycles per statement\n",
+      name[i],
+      (unsigned long long)(basic_compile_time[i] / basic_compile_checked),
+      (unsigned long long)(basic_compile_cycles[i] / basic_compile_checked));
+  }
+}
+
+
+
+static const basic_native_t basic_native[] = {
+  {"fp",     basic_fp_enable},
+  {"var",    basic_var_enable},
+  {"line",   basic_line_enable},
+  {"gc",     basic_gc_enable},
+  {"chrget", basic_chrget_enable},
+  {"compile", basic_compile_enable},
+};
+
+#define BASIC_NATIVE \
+  (int)(sizeof(basic_native) / sizeof(basic_native[0]))
+
+
+
+/* Enable native routines from a comma separated list of names. */
+int basic_native_enable(const char *names)
+{
+  const char *p;
+  size_t length;
+  int i;
+
+  for (p = names; *p != '\0'; p += length) {
+    if (*p == ',') {
+      length = 1;
+      continue;
+    }
+    length = strcspn(p, ",");
+    for (i = 0; i < BASIC_NATIVE; i++) {
+      if (strlen(basic_native[i].name) == length &&
+          strncmp(basic_native[i].name, p, length) == 0) {
+        break;
+      }
+    }
+    if (i == BASIC_NATIVE) {
+      return -1;
+    }
+    (basic_native[i].enable)(true);
+  }
+  return 0;
+}
+
+
+
+static void basic_fp_test_operands(uint8_t *zp)
+{
+  int i;
+
+  for (i = BASIC_RESHO; i <= BASIC_RESLO + 1; i++) {
+    zp[i] = rand();
+  }
+  for (i = BASIC_FACEXP; i <= BASIC_FACOV; i++) {
+    zp[i] = rand();
+  }
+  zp[BASIC_OLDOV] = rand();
+
+  /* BITS is mostly zero, but not cleared by every caller. */
+  zp[BASIC_BITS] = (rand() % 2 == 0) ? 0 : rand();
+
+  /* Unpacked numbers are normalized, with exponents mostly close enough
+     to each other for the mantissas to interact. */
+  zp[BASIC_FACHO] |= 0x80;
+  zp[BASIC_ARGHO] |= 0x80;
+  if (rand() % 4 != 0) {
+    zp[BASIC_ARGEXP] = zp[BASIC_FACEXP] + (rand() % 81) - 40;
+  }
+  if (rand() % 8 == 0) {
+    zp[BASIC_FACOV] = 0;
+  }
+  zp[BASIC_ARISGN] = zp[BASIC_FACSGN] ^ zp[BASIC_ARGSGN];
+}
+
+
+
+static uint8_t basic_fp_test_status(mos6510_t *cpu)
+{
+  mos6510_status_sync(cpu);
+  return (cpu->sr.n << 7) | (cpu->sr.v << 6) | (cpu->sr.z << 1) | cpu->sr.c;
+}
+
+
+
+static bool basic_fp_test_compare(const basic_fp_entry_t *entry,
+  mos6510_t *expected, uint8_t *expected_zp,
+  mos6510_t *actual, uint8_t *actual_zp, uint8_t *operands)
+{
+  int i;
+
+  if (expected->a == actual->a && expected->x == actual->x &&
+      expected->y == actual->y && expected->sp == actual->sp &&
+      expected->pc == actual->pc &&
+      basic_fp_test_status(expected) == basic_fp_test_status(actual) &&
+      memcmp(expected_zp, actual_zp, 0x100) == 0) {
+    return true;
+  }
+
+  fprintf(stdout, "%s mismatch, FAC:", entry->name);
+  for (i = BASIC_FACEXP; i <= BASIC_FACSGN; i++) {
+    fprintf(stdout, " %02x", operands[i]);
+  }
+  fprintf(stdout, " ARG:");
+  for (i = BASIC_ARGEXP; i <= BASIC_FACOV; i++) {
+    fprintf(stdout, " %02x", operands[i]);
+  }
+  fprintf(stdout, "\n  ROM:    A=%02x X=%02x Y=%02x SR=%02x",
+    expected->a, expected->x, expected->y, basic_fp_test_status(expected));
+  fprintf(stdout, "\n  Native: A=%02x X=%02x Y=%02x SR=%02x",
+    actual->a, actual->x, actual->y, basic_fp_test_status(actual));
+  for (i = 0; i < 0x100; i++) {
+    if (expected_zp[i] != actual_zp[i]) {
+      fprintf(stdout, "\n  $%02x: ROM %02x, Native %02x",
+        i, expected_zp[i], actual_zp[i]);
+    }
+  }
+  fprintf(stdout, "\n");
+  return false;
+}
+
+
+
+/* Check the native routines against the ROM on random operands, needs the
+   ROMs loaded and traps not enabled. */
+int basic_fp_test(mos6510_t *cpu, mem_t *mem, int count)
+{
+  const basic_fp_entry_t *entry;
+  mos6510_t start;
+  mos6510_t native;
+  uint8_t operands[0x100];
+  uint8_t native_zp[0x100];
+  uint64_t cycles;
+  int checked;
+  int failed;
+  int steps;
+  int e;
+  int i;
+
+  mem->ram[0x00] = 0x2F;
+  mem->ram[0x01] = 0x37;
+  mem_bank_update(mem);
+  srand(1);
+
+  failed = 0;
+  for (e = 0; e < BASIC_FP_ENTRIES; e++) {
+    entry = &basic_fp_entries[e];
+    checked = 0;
+    cycles = 0;
+    if (! basic_rom_match(mem, entry->address, entry->code, entry->size)) {
+      fprintf(stdout, "%s: Not the stock ROM code at $%04X.\n",
+        entry->name, entry->address);
+      failed++;
+      continue;
+    }
+
+    for (i = 0; i < count; i++) {
+      memcpy(operands, mem->ram, sizeof(operands));
+      basic_fp_test_operands(operands);
+
+      memset(&start, 0, sizeof(start));
+      start.a = rand();
+      start.x = rand();
+      start.y = rand();
+      start.sp = 0xF0;
+      start.z_result = operands[BASIC_FACEXP];
+      start.n_result = operands[BASIC_FACEXP];
+      start.sr.c = rand() & 0x1;
+      start.sr.v = rand() & 0x1;
+      start.sr.i = 1;
+      mem->ram[MEM_PAGE_STACK + 0xF1] = (BASIC_TEST_RETURN - 1) & 0xFF;
+      mem->ram[MEM_PAGE_STACK + 0xF2] = (BASIC_TEST_RETURN - 1) >> 8;
+      start.pc = entry->address;
+
+      native = start;
+      memcpy(native_zp, operands, sizeof(native_zp));
+      if (! basic_fp_native(entry, &native, native_zp)) {
+        continue; /* Left to the ROM anyway. */
+      }
+      mos6510_trap_return(&native, mem);
+      native.cycles = 0;
+
+      *cpu = start;
+      memcpy(mem->ram, operands, sizeof(operands));
+      for (steps = 0; steps < BASIC_TEST_STEPS; steps++) {
+        mos6510_execute(cpu, mem);
+        cycles += cpu->cycles;
+        cpu->cycles = 0;
+        if (cpu->pc == BASIC_TEST_RETURN) {
+          break;
+        }
+      }
+      checked++;
+
+      if (! basic_fp_test_compare(entry, cpu, mem->ram,
+        &native, native_zp, operands)) {
+        failed++;
+        if (failed >= 10) {
+          fprintf(stdout, "Too many mismatches, stopping.\n");
+          return -1;
+        }
+      }
+    }
+
+    fprintf(stdout, "%s: %d of %d operands checked against the ROM",
+      entry->name, checked, count);
+    if (checked > 0) {
+      fprintf(stdout, ", %llu cycles on average",
+        (unsigned long long)(cycles / checked));
+    }
+    fprintf(stdout, ".\n");
+  }
+
+  return (failed == 0) ? 0 : -1;
+}
+
+
+
+/* In token order, same as the ROM keyword table. */
+static const char *basic_keywords[] = {
+  "END", "FOR", "NEXT", "DATA", "INPUT#", "INPUT", "DIM", "READ", "LET",
+  "GOTO", "RUN", "IF", "RESTORE", "GOSUB", "RETURN", "REM", "STOP", "ON",
+  "WAIT", "LOAD", "SAVE", "VERIFY", "DEF", "POKE", "PRINT#", "PRINT",
+  "CONT", "LIST", "CLR", "CMD", "SYS", "OPEN", "CLOSE", "GET", "NEW",
+  "TAB(", "TO", "FN", "SPC(", "THEN", "NOT", "STEP", "+", "-", "*", "/",
+  "^", "AND", "OR", ">", "=", "<", "SGN", "INT", "ABS", "USR", "FRE", "POS",
+  "SQR", "RND", "LOG", "EXP", "COS", "SIN", "TAN", "ATN", "PEEK", "LEN",
+  "STR$", "VAL", "ASC", "CHR$", "LEFT$", "RIGHT$", "MID$", "GO",
+};
+
+#define BASIC_KEYWORDS \
+  (int)(sizeof(basic_keywords) / sizeof(basic_keywords[0]))
+
+/* Same names as used by petcat, as in {clr} or {3 down}. */
+static const basic_escape_t basic_escapes[] = {
+  {"stop", 0x03}, {"wht", 0x05}, {"dish", 0x08}, {"ensh", 0x09},
+  {"swlc", 0x0E}, {"down", 0x11}, {"rvon", 0x12}, {"home", 0x13},
+  {"del", 0x14}, {"red", 0x1C}, {"rght", 0x1D}, {"right", 0x1D},
+  {"grn", 0x1E}, {"blu", 0x1F}, {"space", 0x20}, {"pound", 0x5C},
+  {"up arrow", 0x5E}, {"left arrow", 0x5F}, {"orng", 0x81}, {"f1", 0x85},
+  {"f3", 0x86}, {"f5", 0x87}, {"f7", 0x88}, {"f2", 0x89}, {"f4", 0x8A},
+  {"f6", 0x8B}, {"f8", 0x8C}, {"swuc", 0x8E}, {"blk", 0x90}, {"up", 0x91},
+  {"rvof", 0x92}, {"clr", 0x93}, {"inst", 0x94}, {"brn", 0x95},
+  {"lred", 0x96}, {"gry1", 0x97}, {"gry2", 0x98}, {"lgrn", 0x99},
+  {"lblu", 0x9A}, {"gry3", 0x9B}, {"pur", 0x9C}, {"left", 0x9D},
+  {"yel", 0x9E}, {"cyn", 0x9F}, {"pi", 0xFF},
+};
+
+#define BASIC_ESCAPES \
+  (int)(sizeof(basic_escapes) / sizeof(basic_escapes[0]))
+
+static uint8_t basic_keyword_table[256];
+
+
+
+/* Keywords back to back with the last character of each shifted, and a
+   zero at the end, the way the ROM keeps them. */
+static void basic_keyword_table_init(void)
+{
+  const char *keyword;
+  int i;
+  int j;
+
+  if (basic_keyword_table[0] != 0) {
+    return;
+  }
+  j = 0;
+  for (i = 0; i < BASIC_KEYWORDS; i++) {
+    for (keyword = basic_keywords[i]; *keyword != '\0'; keyword++) {
+      basic_keyword_table[j++] = *keyword;
+    }
+    basic_keyword_table[j - 1] |= 0x80;
+  }
+  basic_keyword_table[j] = 0;
+}
+
+
+
+/* Convert an escape like {clr}, {3 down}, {down*3} or {$93}, returning
+   the number of characters written or -1 if not known or too many. */
+static int basic_listing_escape(const char *escape, size_t length,
+  uint8_t *out, int space)
+{
+  char name[16];
+  unsigned int value;
+  int count;
+  int i;
+
+  count = 1;
+  if (isdigit((unsigned char)escape[0])) {
+    count = atoi(escape);
+    while (length > 0 && isdigit((unsigned char)escape[0])) {
+      escape++;
+      length--;
+    }
+    while (length > 0 && escape[0] == ' ') {
+      escape++;
+      length--;
+    }
+  } else if (memchr(escape, '*', length) != NULL) {
+    i = (const char *)memchr(escape, '*', length) - escape;
+    count = atoi(&escape[i + 1]);
+    length = i;
+  }
+  if (length == 0 || length >= sizeof(name) || count < 1 || count > space) {
+    return -1;
+  }
+  for (i = 0; i < (int)length; i++) {
+    name[i] = tolower((unsigned char)escape[i]);
+  }
+  name[length] = '\0';
+
+  if (name[0] == '$' && sscanf(&name[1], "%x", &value) == 1 &&
+      value <= UINT8_MAX) {
+    memset(out, value, count);
+    return count;
+  }
+  for (i = 0; i < BASIC_ESCAPES; i++) {
+    if (strcmp(basic_escapes[i].name, name) == 0) {
+      memset(out, basic_escapes[i].petscii, count);
+      return count;
+    }
+  }
+  return -1;
+}
+
+
+
+/* Convert a listing line to PETSCII, as it would be on the screen. With
+   lowercase in the listing it is taken to be unshifted, and uppercase to
+   be shifted, otherwise uppercase is unshifted. */
+static int basic_listing_petscii(const char *line, bool lowercase,
+  uint8_t *out)
+{
+  const char *end;
+  int length;
+  int n;
+
+  length = 0;
+  for (; *line != '\0' && *line != '\n' && *line != '\r'; line++) {
+    if (length >= BASIC_LISTING_LINE_MAX) {
+      return -1;
+    }
+    if (*line == '{') {
+      end = strchr(line, '}');
+      if (end == NULL) {
+        return -1;
+      }
+      n = basic_listing_escape(line + 1, end - line - 1, &out[length],
+        BASIC_LISTING_LINE_MAX - length);
+      if (n < 0) {
+        return -1;
+      }
+      length += n;
+      line = end;
+    } else if (*line >= 'a' && *line <= 'z') {
+      out[length++] = *line - 'a' + 0x41;
+    } else if (*line >= 'A' && *line <= 'Z') {
+      out[length++] = *line - 'A' + ((lowercase) ? 0xC1 : 0x41);
+    } else if (*line == '\t') {
+      out[length++] = ' ';
+    } else if (*line == '~') {
+      out[length++] = 0xFF; /* Pi */
+    } else {
+      out[length++] = *line;
+    }
+  }
+
+  /* The screen editor leaves out trailing spaces. */
+  while (length > 0 && out[length - 1] == ' ') {
+    length--;
+  }
+  out[length] = 0;
+  return length;
+}
+
+
+
+/* Same as CRUNCH in the ROM, returning the tokenized length. This never
+   makes a line longer, so the output fits where the input does. Shifted
+   characters outside of strings would be dropped, which for a listing
+   means its case was taken the wrong way, so that fails instead. */
+static int basic_listing_crunch(const uint8_t *in, uint8_t *out)
+{
+  uint8_t c;
+  uint8_t end;
+  int count;
+  int start;
+  int x;
+  int y;
+  int o;
+  bool data;
+
+  data = false;
+  x = 0;
+  o = 0;
+  while (1) {
+    c = in[x];
+    if (c >= 0x80 && c != 0xFF) {
+      return -1;
+    }
+
+    if (c == '"') {
+      end = '"';
+      out[o++] = in[x++];
+      while (in[x] != 0 && in[x] != end) {
+        out[o++] = in[x++];
+      }
+      c = in[x];
+    } else if (c != ' ' && c != 0xFF && ! data) {
+      if (c == '?') {
+        c = BASIC_TOKEN_PRINT;
+      } else if (c < '0' || c >= '<') {
+        /* Try the keywords in order. A shifted character ends a keyword
+           early, which is how abbreviations work. */
+        start = x;
+        count = 0;
+        y = 0;
+        while (1) {
+          c = in[x] - basic_keyword_table[y];
+          if (c == 0) {
+            x++;
+            y++;
+            continue;
+          }
+          if (c == 0x80) {
+            c = 0x80 | count;
+            break;
+          }
+          x = start;
+          count++;
+          while (basic_keyword_table[y++] < 0x80) {
+            ;
+          }
+          if (basic_keyword_table[y] == 0) {
+            c = in[x];
+            break;
+          }
+        }
+      }
+    }
+
+    out[o++] = c;
+    x++;
+    if (c == 0) {
+      return o - 1;
+    } else if (c == ':') {
+      data = false;
+    } else if (c == BASIC_TOKEN_DATA) {
+      data = true;
+    } else if (c == BASIC_TOKEN_REM) {
+      while (in[x] != 0) {
+        out[o++] = in[x++];
+      }
+    }
+  }
+}
+
+
+
+/* Line number with spaces anywhere in it, as LINGET reads it. */
+static int basic_listing_number(const uint8_t *in, int *number)
+{
+  int x;
+
+  x = 0;
+  while (in[x] == ' ') {
+    x++;
+  }
+  if (! isdigit(in[x])) {
+    return -1;
+  }
+  *number = 0;
+  while (isdigit(in[x]) || in[x] == ' ') {
+    if (in[x] != ' ') {
+      if (*number >= (BASIC_LISTING_NUMBER_MAX + 1) / 10) {
+        return -1;
+      }
+      *number = (*number * 10) + (in[x] - '0');
+    }
+    x++;
+  }
+  return x;
+}
+
+
+
+static int basic_listing_compare(const void *a, const void *b)
+{
+  const basic_listing_line_t *la = a;
+  const basic_listing_line_t *lb = b;
+
+  if (la->number != lb->number) {
+    return (la->number < lb->number) ? -1 : 1;
+  }
+  return (la->order < lb->order) ? -1 : 1;
+}
+
+
+
+/* Only checks the file name, listings are expected to end with ".bas". */
+bool basic_listing_name(const char *filename)
+{
+  size_t length;
+
+  length = strlen(filename);
+  return length > 4 && tolower((unsigned char)filename[length - 1]) == 's' &&
+    tolower((unsigned char)filename[length - 2]) == 'a' &&
+    tolower((unsigned char)filename[length - 3]) == 'b' &&
+    filename[length - 4] == '.';
+}
+
+
+
+/* Escapes are left out when looking at the case. */
+static bool basic_listing_lowercase(FILE *fh)
+{
+  char line[BASIC_LISTING_LINE_MAX * 4];
+  bool lowercase;
+  int escape;
+  int i;
+
+  lowercase = false;
+  while (fgets(line, sizeof(line), fh) != NULL) {
+    escape = 0;
+    for (i = 0; line[i] != '\0'; i++) {
+      if (line[i] == '{') {
+        escape++;
+      } else if (line[i] == '}' && escape > 0) {
+        escape--;
+      } else if (escape == 0 && islower((unsigned char)line[i])) {
+        lowercase = true;
+      }
+    }
+  }
+  rewind(fh);
+  return lowercase;
+}
+
+
+
+/* Tokenized lines in listing order, or -1 if any of them is bad. */
+static int basic_listing_read(FILE *fh, basic_listing_line_t **lines,
+  int *count)
+{
+  char line[BASIC_LISTING_LINE_MAX * 4];
+  uint8_t petscii[BASIC_LISTING_LINE_MAX + 1];
+  basic_listing_line_t *l;
+  bool lowercase;
+  int number;
+  int length;
+  int start;
+
+  lowercase = basic_listing_lowercase(fh);
+  basic_keyword_table_init();
+
+  *lines = NULL;
+  *count = 0;
+  while (fgets(line, sizeof(line), fh) != NULL) {
+    length = basic_listing_petscii(line, lowercase, petscii);
+    if (length == 0) {
+      continue; /* Empty lines are allowed. */
+    }
+    start = (length > 0) ? basic_listing_number(petscii, &number) : -1;
+    if (start < 0 || *count >= UINT16_MAX) {
+      free(*lines);
+      return -1;
+    }
+
+    if ((*count % 256) == 0) {
+      l = realloc(*lines, (*count + 256) * sizeof(basic_listing_line_t));
+      if (l == NULL) {
+        free(*lines);
+        return -1;
+      }
+      *lines = l;
+    }
+    l = &(*lines)[*count];
+    length = basic_listing_crunch(&petscii[start], l->text);
+    if (length < 0) {
+      free(*lines);
+      return -1;
+    }
+    l->number = number;
+    l->order = *count;
+    l->length = length;
+    (*count)++;
+  }
+
+  if (*count > 0) {
+    qsort(*lines, *count, sizeof(basic_listing_line_t),
+      basic_listing_compare);
+  }
+  return 0;
+}
+
+
+
+/* Tokenize a text listing and put it in memory at TXTTAB, as if typed
+   in. Lines with a number only delete that line, like when typed. */
+int basic_load_listing(mem_t *mem, const char *filename)
+{
+  FILE *fh;
+  basic_listing_line_t *lines;
+  basic_listing_line_t *l;
+  uint16_t address;
+  uint16_t next;
+  int count;
+  int i;
+
+  fh = fopen(filename, "rb");
+  if (fh == NULL) {
+    return -1;
+  }
+  if (basic_listing_read(fh, &lines, &count) != 0) {
+    fclose(fh);
+    return -1;
+  }
+  fclose(fh);
+  /* Without any lines this leaves an empty program, like NEW. */
+
+  address = basic_word(mem, BASIC_TXTTAB);
+  if (address == 0 || address >= BASIC_LISTING_END) {
+    address = BASIC_LISTING_START;
+  }
+  mem->ram[address - 1] = 0;
+  for (i = 0; i < count; i++) {
+    l = &lines[i];
+    if ((i + 1 < count && lines[i + 1].number == l->number) ||
+      l->length == 0) {
+      continue; /* Replaced or deleted. */
+    }
+    next = address + l->length + 5;
+    if (next + 2 > BASIC_LISTING_END) {
+      free(lines);
+      return -1;
+    }
+    mem->ram[address]     = next & 0xFF;
+    mem->ram[address + 1] = next >> 8;
+    mem->ram[address + 2] = l->number & 0xFF;
+    mem->ram[address + 3] = l->number >> 8;
+    memcpy(&mem->ram[address + 4], l->text, l->length);
+    mem->ram[next - 1] = 0;
+    address = next;
+  }
+  mem->ram[address]     = 0;
+  mem->ram[address + 1] = 0;
+  address += 2;
+  free(lines);
+
+  /* Variables start right after, same as mem_load_prg(). */
+  mem->ram[BASIC_VARTAB]     = address & 0xFF;
+  mem->ram[BASIC_VARTAB + 1] = address >> 8;
+  mem->ram[BASIC_ARYTAB]     = address & 0xFF;
+  mem->ram[BASIC_ARYTAB + 1] = address >> 8;
+  mem->ram[BASIC_STREND]     = address & 0xFF;
+  mem->ram[BASIC_STREND + 1] = address >> 8;
+
+  mem_code_flush(mem);
+  return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef _BASIC_H
+#define _BASIC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "mos6510.h"
+#include "mem.h"
+
+void basic_fp_enable(bool enable);
+void basic_var_enable(bool enable);
+void basic_line_enable(bool enable);
+void basic_gc_enable(bool enable);
+void basic_gc_check_enable(bool enable);
+void basic_chrget_enable(bool enable);
+void basic_compile_enable(bool enable);
+void basic_compile_check_enable(bool enable);
+void basic_compile_report(FILE *fh);
+int basic_native_enable(const char *names);
+int basic_fp_test(mos6510_t *cpu, mem_t *mem, int count);
+bool basic_listing_name(const char *filename);
+int basic_load_listing(mem_t *mem, const char *filename);
+
+#endif /* _BASIC_H */
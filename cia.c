@@ -7,6 +7,7 @@
 #include "cia.h"
 #include "mos6510.h"
 #include "joystick.h"
+#include "scheduler.h"
 
 
 
@@ -17,12 +18,174 @@ static uint8_t bcd(uint8_t value)
 
 
 
+static inline uint32_t cia_timer_left(cia_timer_t *timer)
+{
+  /* Counter is decremented first, so zero means a full wrap. */
+  return (timer->counter == 0) ? 0x10000 : timer->counter;
+}
+
+
+
+static inline uint32_t cia_timer_period(cia_timer_t *timer)
+{
+  return (timer->latch == 0) ? 0x10000 : timer->latch;
+}
+
+
+
+static inline bool cia_timer_b_cascade(cia_t *cia)
+{
+  /* Count timer A underflows, CNT is assumed to always be high. */
+  return (cia->timer_b.control & 0x40) != 0;
+}
+
+
+
+static uint64_t cia_timer_advance(cia_timer_t *timer, uint64_t ticks)
+{
+  uint32_t left;
+  uint32_t period;
+
+  /* Advance the timer by a number of ticks in closed form and return the
+     number of underflows that happened along the way. */
+  if ((timer->control & 0x1) == 0) { /* Start */
+    return 0;
+  }
+
+  left = cia_timer_left(timer);
+  if (ticks < left) {
+    timer->counter -= ticks;
+    return 0;
+  }
+  ticks -= left;
+
+  timer->counter = timer->latch;
+  if (timer->control & 0x8) { /* One Shot */
+    timer->control &= ~0x1;
+    return 1;
+  }
+
+  period = cia_timer_period(timer);
+  timer->counter -= ticks % period;
+  return 1 + (ticks / period);
+}
+
+
+
+static void cia_timer_underflow(cia_t *cia, uint8_t icr_flag)
+{
+  cia->icr_status |= icr_flag;
+  if (cia->icr_mask & icr_flag) { /* Underflow Interrupt */
+    cia->icr_status |= 0x80;
+    if (cia->no == 1) {
+      mos6510_irq((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
+    } else if (cia->no == 2) {
+      mos6510_nmi((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
+    }
+  }
+}
+
+
+
+static void cia_update(cia_t *cia, uint64_t cycle)
+{
+  uint64_t cycles;
+  uint64_t underflows;
+
+  cycles = cycle - cia->cycle;
+  cia->cycle = cycle;
+
+  /* Several underflows may be folded into one update, but only when the
+     interrupt is masked, since otherwise an event is due at each one. */
+  underflows = cia_timer_advance(&cia->timer_a, cycles);
+  if (underflows > 0) {
+    cia_timer_underflow(cia, 0x1);
+  }
+
+  if (cia_timer_b_cascade(cia)) {
+    underflows = cia_timer_advance(&cia->timer_b, underflows);
+  } else if (cia->timer_b.control & 0x20) {
+    underflows = 0; /* Nothing drives the CNT pin. */
+  } else {
+    underflows = cia_timer_advance(&cia->timer_b, cycles);
+  }
+  if (underflows > 0) {
+    cia_timer_underflow(cia, 0x2);
+  }
+}
+
+
+
+static uint64_t cia_timer_b_next(cia_t *cia)
+{
+  uint32_t left;
+
+  if ((cia->timer_b.control & 0x1) == 0) {
+    return UINT64_MAX;
+  }
+
+  left = cia_timer_left(&cia->timer_b);
+  if (cia_timer_b_cascade(cia)) {
+    /* Underflows on the n'th timer A underflow from now. */
+    if ((cia->timer_a.control & 0x1) == 0) {
+      return UINT64_MAX;
+    }
+    if (left > 1 && (cia->timer_a.control & 0x8)) {
+      return UINT64_MAX; /* Timer A stops before getting there. */
+    }
+    return cia->cycle + cia_timer_left(&cia->timer_a) +
+      ((uint64_t)(left - 1) * cia_timer_period(&cia->timer_a));
+
+  } else if (cia->timer_b.control & 0x20) {
+    return UINT64_MAX;
+
+  } else {
+    return cia->cycle + left;
+  }
+}
+
+
+
+static void cia_schedule(cia_t *cia)
+{
+  uint64_t next = UINT64_MAX;
+
+  /* Only underflows that raise an interrupt need an event, the rest are
+     accounted for in closed form on the next register access. */
+  if ((cia->icr_mask & 0x1) && (cia->timer_a.control & 0x1)) {
+    next = cia->cycle + cia_timer_left(&cia->timer_a);
+  }
+  if (cia->icr_mask & 0x2) {
+    if (cia_timer_b_next(cia) < next) {
+      next = cia_timer_b_next(cia);
+    }
+  }
+
+  if (next == UINT64_MAX) {
+    scheduler_remove(cia->event);
+  } else {
+    scheduler_add(cia->event, next);
+  }
+}
+
+
+
+static void cia_event(void *cia, uint64_t cycle)
+{
+  cia_update((cia_t *)cia, cycle);
+  cia_schedule((cia_t *)cia);
+}
+
+
+
 uint8_t cia_read_hook(void *cia, uint16_t address)
 {
   uint8_t value;
   struct timespec tp;
   struct tm tm;
 
+  cia_update((cia_t *)cia, scheduler_cycle);
+
   switch (address & 0xF) {
   case CIA_PRA:
     if (((cia_t *)cia)->no == 1) {
@@ -99,9 +262,15 @@ uint8_t cia_read_hook(void *cia, uint16_t address)
 
 void cia_write_hook(void *cia, uint16_t address, uint8_t value)
 {
+  cia_update((cia_t *)cia, scheduler_cycle);
+
   switch (address & 0xF) {
   case CIA_PRA:
     ((cia_t *)cia)->data_port_a = value;
+    if (((cia_t *)cia)->no == 2) {
+      /* Let the serial bus react to the new signal states. */
+      scheduler_add(SCHEDULER_EVENT_SERIAL_BUS, scheduler_cycle);
+    }
     break;
 
   case CIA_PRB:
@@ -119,6 +288,7 @@ void cia_write_hook(void *cia, uint16_t address, uint8_t value)
   case CIA_TA_LO:
     ((cia_t *)cia)->timer_a.latch = 
       (((cia_t *)cia)->timer_a.latch & 0xFF00) | value;
+    cia_schedule((cia_t *)cia); /* Timer B may be cascaded. */
     break;
 
   case CIA_TA_HI:
@@ -128,6 +298,7 @@ void cia_write_hook(void *cia, uint16_t address, uint8_t value)
     if ((((cia_t *)cia)->timer_a.control & 0x1) == 0) {
       ((cia_t *)cia)->timer_a.counter = ((cia_t *)cia)->timer_a.latch;
     }
+    cia_schedule((cia_t *)cia);
     break;
 
   case CIA_TB_LO:
@@ -142,6 +313,7 @@ void cia_write_hook(void *cia, uint16_t address, uint8_t value)
     if ((((cia_t *)cia)->timer_b.control & 0x1) == 0) {
       ((cia_t *)cia)->timer_b.counter = ((cia_t *)cia)->timer_b.latch;
     }
+    cia_schedule((cia_t *)cia);
     break;
 
   case CIA_ICR:
@@ -150,14 +322,25 @@ void cia_write_hook(void *cia, uint16_t address, uint8_t value)
     } else { /* Clear Mask */
       ((cia_t *)cia)->icr_mask &= ~(value & 0x1F);
     }
+    cia_schedule((cia_t *)cia);
     break;
 
   case CIA_CRA:
     ((cia_t *)cia)->timer_a.control = value;
+    if (value & 0x10) { /* Timer A Force Load */
+      ((cia_t *)cia)->timer_a.counter = ((cia_t *)cia)->timer_a.latch;
+      ((cia_t *)cia)->timer_a.control &= ~0x10;
+    }
+    cia_schedule((cia_t *)cia);
     break;
 
   case CIA_CRB:
     ((cia_t *)cia)->timer_b.control = value;
+    if (value & 0x10) { /* Timer B Force Load */
+      ((cia_t *)cia)->timer_b.counter = ((cia_t *)cia)->timer_b.latch;
+      ((cia_t *)cia)->timer_b.control &= ~0x10;
+    }
+    cia_schedule((cia_t *)cia);
     break;
 
   default:
@@ -182,61 +365,11 @@ void cia_init(cia_t *cia, int cia_no)
   cia->data_port_b = 0x0;
   cia->data_dir_a = 0x0;
   cia->data_dir_b = 0x0;
+  cia->cycle = scheduler_cycle;
+  cia->event = (cia_no == 1) ? SCHEDULER_EVENT_CIA1 : SCHEDULER_EVENT_CIA2;
   cia->cpu = NULL;
   cia->mem = NULL;
-}
-
-
-
-void cia_execute(cia_t *cia)
-{
-  if (cia->timer_a.control & 0x10) { /* Timer A Force Load */
-    cia->timer_a.counter = cia->timer_a.latch;
-    cia->timer_a.control &= ~0x10;
-  }
-  if (cia->timer_b.control & 0x10) { /* Timer B Force Load */
-    cia->timer_b.counter = cia->timer_b.latch;
-    cia->timer_b.control &= ~0x10;
-  }
-
-  if (cia->timer_a.control & 0x1) { /* Timer A Start */
-    cia->timer_a.counter--;
-    if (cia->timer_a.counter == 0) {
-      cia->icr_status |= 0x1;
-      if (cia->icr_mask & 0x1) { /* Timer A Underflow Interrupt */
-        cia->icr_status |= 0x80;
-        if (cia->no == 1) {
-          mos6510_irq((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
-        } else if (cia->no == 2) {
-          mos6510_nmi((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
-        }
-      }
-
-      cia->timer_a.counter = cia->timer_a.latch;
-      if (cia->timer_a.control & 0x8) { /* Timer A One Shot */
-        cia->timer_a.control &= ~0x1;
-      }
-    }
-  }
-  if (cia->timer_b.control & 0x1) { /* Timer B Start */
-    cia->timer_b.counter--;
-    if (cia->timer_b.counter == 0) {
-      cia->icr_status |= 0x2;
-      if (cia->icr_mask & 0x2) { /* Timer B Underflow Interrupt */
-        cia->icr_status |= 0x80;
-        if (cia->no == 1) {
-          mos6510_irq((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
-        } else if (cia->no == 2) {
-          mos6510_nmi((mos6510_t *)cia->cpu, (mem_t *)cia->mem);
-        }
-      }
-
-      cia->timer_b.counter = cia->timer_b.latch;
-      if (cia->timer_b.control & 0x8) { /* Timer B One Shot */
-        cia->timer_b.control &= ~0x1;
-      }
-    }
-  }
+  scheduler_attach(cia->event, cia_event, cia);
 }
 
 
@@ -256,6 +389,7 @@ static void cia_port_dump(FILE *fh, uint8_t value, uint8_t direction)
 
 void cia_dump(FILE *fh, cia_t *cia)
 {
+  cia_update(cia, scheduler_cycle);
   fprintf(fh, "CIA #%d\n", cia->no);
   fprintf(fh, "  ICR Status: 0x%02x\n", cia->icr_status);
   fprintf(fh, "  ICR Mask  : 0x%02x\n", cia->icr_mask);
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "scheduler.h"
+
 typedef struct cia_timer_s {
   uint8_t control;
   uint16_t latch;
@@ -17,6 +19,8 @@ typedef struct cia_s {
   uint8_t icr_mask;
   cia_timer_t timer_a;
   cia_timer_t timer_b;
+  uint64_t cycle; /* Timers are up to date until this cycle. */
+  scheduler_event_t event;
   void *cpu;
   void *mem;
   uint8_t data_port_a;
@@ -45,7 +49,6 @@ typedef struct cia_s {
 uint8_t cia_read_hook(void *cia, uint16_t address);
 void cia_write_hook(void *cia, uint16_t address, uint8_t value);
 void cia_init(cia_t *cia, int cia_no);
-void cia_execute(cia_t *cia);
 void cia_dump(FILE *fh, cia_t *cia);
 
 #endif /* _CIA_H */
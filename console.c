@@ -189,7 +189,6 @@ void console_init(void)
 
 void console_execute(mem_t *mem, vic_t *vic)
 {
-  static int cycle = 0;
   int row, col;
   uint16_t address;
   uint8_t petscii;
@@ -202,12 +201,6 @@ void console_execute(mem_t *mem, vic_t *vic)
   bool charset;
   int c;
 
-  /* Only run every X cycle. */
-  cycle++;
-  if (cycle % 20000 != 0) {
-    return;
-  }
-
   /* Output */
   for (row = 0; row < 25; row++) {
     for (col = 0; col < 40; col++) {
@@ -312,6 +305,7 @@ void console_execute(mem_t *mem, vic_t *vic)
   if (c != ERR) {
     switch (c) {
     case KEY_RESIZE:
+      petscii = 0;
       break;
 
     case KEY_ENTER:
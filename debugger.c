@@ -11,93 +11,95 @@
 #include "vic.h"
 #include "serial_bus.h"
 #include "disk.h"
+#include "basic.h"
+#include "profile.h"
 #include "panic.h"
 #include "debugger.h"
 
 #define DEBUGGER_ARGS 3
-#define DEBUGGER_BREAKPOINT_MAX 5
 #define DEBUGGER_STACK_TRACE_SIZE 128
 
-typedef struct debugger_breakpoint_s {
-  uint16_t address;
-  bool read;
-  bool write;
-  bool execute;
-} debugger_breakpoint_t;
-
 typedef struct debugger_stack_trace_s {
   uint16_t from;
   uint16_t to;
 } debugger_stack_trace_t;
 
-debugger_breakpoint_t debugger_breakpoint[DEBUGGER_BREAKPOINT_MAX];
+uint8_t debugger_breakpoint_map[DEBUGGER_BREAKPOINT_TYPES]
+                               [(UINT16_MAX + 1) / 8];
+int debugger_breakpoint_count = 0;
 
 static debugger_stack_trace_t debugger_stack_trace[DEBUGGER_STACK_TRACE_SIZE];
 static int debugger_stack_trace_index = 0;
-static char *debugger_symtab[UINT16_MAX + 1];
+static const char *debugger_symtab[UINT16_MAX + 1];
 
 
 
-static void debugger_breakpoint_list(void)
+static inline bool debugger_breakpoint_get(int type, uint16_t address)
 {
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    if (debugger_breakpoint[i].read == true) {
-      fprintf(stdout, "%d: 0x%04x (r)\n", i+1, debugger_breakpoint[i].address);
-    }
-    if (debugger_breakpoint[i].write == true) {
-      fprintf(stdout, "%d: 0x%04x (w)\n", i+1, debugger_breakpoint[i].address);
-    }
-    if (debugger_breakpoint[i].execute == true) {
-      fprintf(stdout, "%d: 0x%04x (x)\n", i+1, debugger_breakpoint[i].address);
-    }
-  }
+  return (debugger_breakpoint_map[type][address >> 3] >> (address & 0x7)) & 1;
 }
 
-
-
-static void debugger_breakpoint_add(uint16_t address, int type)
+static inline void debugger_breakpoint_set(int type, uint16_t address,
+  bool enable)
 {
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    if (debugger_breakpoint[i].read == false &&
-        debugger_breakpoint[i].write == false &&
-        debugger_breakpoint[i].execute == false) {
-
-      debugger_breakpoint[i].address = address;
-      switch (type) {
-      case 0:
-        debugger_breakpoint[i].read = true;
-        break;
+  if (enable == debugger_breakpoint_get(type, address)) {
+    return;
+  }
+  if (enable) {
+    debugger_breakpoint_map[type][address >> 3] |= (1 << (address & 0x7));
+    debugger_breakpoint_count++;
+  } else {
+    debugger_breakpoint_map[type][address >> 3] &= ~(1 << (address & 0x7));
+    debugger_breakpoint_count--;
+  }
+}
 
-      case 1:
-        debugger_breakpoint[i].write = true;
-        break;
 
-      case 2:
-        debugger_breakpoint[i].execute = true;
-        break;
 
-      default:
-        break;
+static void debugger_breakpoint_list(void)
+{
+  int address;
+  int type;
+  int no = 1;
+  const char type_indicator[DEBUGGER_BREAKPOINT_TYPES] = {'r', 'w', 'x'};
+
+  for (address = 0; address <= UINT16_MAX; address++) {
+    for (type = 0; type < DEBUGGER_BREAKPOINT_TYPES; type++) {
+      if (debugger_breakpoint_get(type, address)) {
+        fprintf(stdout, "%d: 0x%04x (%c)\n", no, address,
+          type_indicator[type]);
+        no++;
       }
-      return;
     }
   }
+}
+
+
 
-  fprintf(stdout, "Max breakpoints reached!\n");
+static void debugger_breakpoint_add(uint16_t address, int type)
+{
+  debugger_breakpoint_set(type, address, true);
 }
 
 
 
 static void debugger_breakpoint_del(int breakpoint_no)
 {
-  breakpoint_no--; /* Convert to zero-indexed. */
-  if (breakpoint_no >= 0 && breakpoint_no < DEBUGGER_BREAKPOINT_MAX) {
-    debugger_breakpoint[breakpoint_no].address = 0;
-    debugger_breakpoint[breakpoint_no].read = false;
-    debugger_breakpoint[breakpoint_no].write = false;
-    debugger_breakpoint[breakpoint_no].execute = false;
+  int address;
+  int type;
+  int no = 1;
+
+  /* Numbering follows the order of the breakpoint list. */
+  for (address = 0; address <= UINT16_MAX; address++) {
+    for (type = 0; type < DEBUGGER_BREAKPOINT_TYPES; type++) {
+      if (debugger_breakpoint_get(type, address)) {
+        if (no == breakpoint_no) {
+          debugger_breakpoint_set(type, address, false);
+          return;
+        }
+        no++;
+      }
+    }
   }
 }
 
@@ -111,8 +113,12 @@ static void debugger_help(void)
   fprintf(stdout, "  c              - Continue\n");
   fprintf(stdout, "  s              - Step\n");
   fprintf(stdout, "  r              - CPU Reset\n");
-  fprintf(stdout, "  t              - Dump CPU Trace\n");
+  fprintf(stdout, "  t [num]        - Dump CPU Trace\n");
+  fprintf(stdout, "  t on | t off   - Enable/Disable CPU Trace\n");
+  fprintf(stdout, "  tp [num]       - Dump CPU Trace Opcode Pairs\n");
   fprintf(stdout, "  y              - Dump Stack Trace\n");
+  fprintf(stdout, "  o [num]        - Dump BASIC Profile\n");
+  fprintf(stdout, "  n              - Dump BASIC Compile Check Timing\n");
   fprintf(stdout, "  z              - Dump Zero Page\n");
   fprintf(stdout, "  k              - Dump Stack\n");
   fprintf(stdout, "  p              - Dump Program Area\n");
@@ -123,7 +129,7 @@ static void debugger_help(void)
   fprintf(stdout, "  bw <addr>      - Breakpoint on Memory Write\n");
   fprintf(stdout, "  bx <addr>      - Breakpoint on Execute\n");
   fprintf(stdout, "  bd <no>        - Breakpoint Delete\n");
-  fprintf(stdout, "  l <prg>        - Load PRG\n");
+  fprintf(stdout, "  l <prg|bas>    - Load PRG or BASIC Listing\n");
   fprintf(stdout, "  8 <d64>        - Load D64 in Device #8\n");
   fprintf(stdout, "  a              - Dump CIA Registers\n");
   fprintf(stdout, "  v              - Dump VIC-II Registers\n");
@@ -136,13 +142,8 @@ static void debugger_help(void)
 
 void debugger_init(void)
 {
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    debugger_breakpoint[i].address = 0;
-    debugger_breakpoint[i].read = false;
-    debugger_breakpoint[i].write = false;
-    debugger_breakpoint[i].execute = false;
-  }
+  memset(debugger_breakpoint_map, 0, sizeof(debugger_breakpoint_map));
+  debugger_breakpoint_count = 0;
 }
 
 
@@ -201,8 +202,41 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
       return false;
 
     } else if (strncmp(argv[0], "t", 1) == 0) {
-      fprintf(stdout, "CPU Trace:\n");
-      mos6510_trace_dump(stdout);
+      if (strncmp(argv[0], "tp", 2) == 0) {
+        if (argc >= 2) {
+          sscanf(argv[1], "%d", &value1);
+        } else {
+          value1 = MOS6510_TRACE_DUMP_DEFAULT;
+        }
+        fprintf(stdout, "CPU Trace Opcode Pairs:\n");
+        mos6510_trace_pairs(stdout, mem, value1);
+      } else if (argc >= 2 && strncmp(argv[1], "on", 2) == 0) {
+        mos6510_trace_enable(true);
+        fprintf(stdout, "CPU Trace: %s\n",
+          (mos6510_trace_enabled) ? "On" : "Failed");
+      } else if (argc >= 2 && strncmp(argv[1], "off", 3) == 0) {
+        mos6510_trace_enable(false);
+        fprintf(stdout, "CPU Trace: Off\n");
+      } else {
+        if (argc >= 2) {
+          sscanf(argv[1], "%d", &value1);
+        } else {
+          value1 = MOS6510_TRACE_DUMP_DEFAULT;
+        }
+        fprintf(stdout, "CPU Trace:\n");
+        mos6510_trace_dump(stdout, mem, value1);
+      }
+
+    } else if (strncmp(argv[0], "o", 1) == 0) {
+      if (argc >= 2) {
+        sscanf(argv[1], "%d", &value1);
+      } else {
+        value1 = PROFILE_REPORT_DEFAULT;
+      }
+      profile_report(stdout, value1);
+
+    } else if (strncmp(argv[0], "n", 1) == 0) {
+      basic_compile_report(stdout);
 
     } else if (strncmp(argv[0], "y", 1) == 0) {
       fprintf(stdout, "Stack Trace:\n");
@@ -241,6 +275,10 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
         sscanf(argv[1], "%4x", &value1);
         sscanf(argv[2], "%2x", &value2);
         mem->ram[value1 & 0xFFFF] = value2 & 0xFF;
+        if ((value1 & 0xFFFF) <= 0x0001) {
+          mem_bank_update(mem);
+        }
+        mem_code_flush(mem);
       } else {
         fprintf(stdout, "Missing argument!\n");
       }
@@ -252,7 +290,7 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
     } else if (strncmp(argv[0], "br", 2) == 0) {
       if (argc >= 2) {
         sscanf(argv[1], "%4x", &value1);
-        debugger_breakpoint_add(value1, 0);
+        debugger_breakpoint_add(value1, DEBUGGER_BREAKPOINT_READ);
       } else {
         fprintf(stdout, "Missing argument!\n");
       }
@@ -260,7 +298,7 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
     } else if (strncmp(argv[0], "bw", 2) == 0) {
       if (argc >= 2) {
         sscanf(argv[1], "%4x", &value1);
-        debugger_breakpoint_add(value1, 1);
+        debugger_breakpoint_add(value1, DEBUGGER_BREAKPOINT_WRITE);
       } else {
         fprintf(stdout, "Missing argument!\n");
       }
@@ -268,7 +306,7 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
     } else if (strncmp(argv[0], "bx", 2) == 0) {
       if (argc >= 2) {
         sscanf(argv[1], "%4x", &value1);
-        debugger_breakpoint_add(value1, 2);
+        debugger_breakpoint_add(value1, DEBUGGER_BREAKPOINT_EXECUTE);
       } else {
         fprintf(stdout, "Missing argument!\n");
       }
@@ -283,7 +321,12 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
 
     } else if (strncmp(argv[0], "l", 1) == 0) {
       if (argc >= 2) {
-        if (mem_load_prg(mem, argv[1]) != 0) {
+        if (basic_listing_name(argv[1])) {
+          value1 = basic_load_listing(mem, argv[1]);
+        } else {
+          value1 = mem_load_prg(mem, argv[1]);
+        }
+        if (value1 != 0) {
           fprintf(stdout, "Loading of '%s' failed!\n", argv[1]);
         }
       } else {
@@ -331,49 +374,151 @@ bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus)
 
 
 
-void debugger_mem_read(uint16_t address)
-{
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    if (debugger_breakpoint[i].read == true  &&
-        debugger_breakpoint[i].address == address) {
-      debugger_break = true;
-    }
-  }
-}
-
-
-
-void debugger_mem_write(uint16_t address, uint8_t value)
-{
-  (void)value; /* Not currently used. */
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    if (debugger_breakpoint[i].write == true  &&
-        debugger_breakpoint[i].address == address) {
-      debugger_break = true;
-    }
-  }
-}
-
-
-
-void debugger_mem_execute(uint16_t address)
-{
-  int i;
-  for (i = 0; i < DEBUGGER_BREAKPOINT_MAX; i++) {
-    if (debugger_breakpoint[i].execute == true  &&
-        debugger_breakpoint[i].address == address) {
-      debugger_break = true;
-    }
-  }
-}
-
-
-
 void debugger_stack_trace_init(void)
 {
   memset(debugger_symtab, 0, (UINT16_MAX + 1) * (sizeof(char *)));
+  debugger_symtab[0x0073] = "CHRGET";
+  debugger_symtab[0x0079] = "CHRGOT";
+  debugger_symtab[0xA3B8] = "BLTU";
+  debugger_symtab[0xA408] = "REASON";
+  debugger_symtab[0xA437] = "ERROR";
+  debugger_symtab[0xA474] = "READY";
+  debugger_symtab[0xA480] = "MAIN";
+  debugger_symtab[0xA49C] = "MAIN1";
+  debugger_symtab[0xA533] = "LNKPRG";
+  debugger_symtab[0xA560] = "INLIN";
+  debugger_symtab[0xA579] = "CRUNCH";
+  debugger_symtab[0xA613] = "FNDLIN";
+  debugger_symtab[0xA617] = "FNDLNC";
+  debugger_symtab[0xA642] = "SCRTCH";
+  debugger_symtab[0xA65E] = "CLEARC";
+  debugger_symtab[0xA68E] = "STXPT";
+  debugger_symtab[0xA69C] = "LIST";
+  debugger_symtab[0xA742] = "FOR";
+  debugger_symtab[0xA7AE] = "NEWSTT";
+  debugger_symtab[0xA7E4] = "GONE";
+  debugger_symtab[0xA81D] = "RESTOR";
+  debugger_symtab[0xA82C] = "ISCNTC";
+  debugger_symtab[0xA82F] = "STOP";
+  debugger_symtab[0xA831] = "END";
+  debugger_symtab[0xA857] = "CONT";
+  debugger_symtab[0xA871] = "RUN";
+  debugger_symtab[0xA883] = "GOSUB";
+  debugger_symtab[0xA8A0] = "GOTO";
+  debugger_symtab[0xA8D2] = "RETURN";
+  debugger_symtab[0xA8F8] = "DATA";
+  debugger_symtab[0xA906] = "DATAN";
+  debugger_symtab[0xA928] = "IF";
+  debugger_symtab[0xA93B] = "REM";
+  debugger_symtab[0xA94B] = "ONGOTO";
+  debugger_symtab[0xA96B] = "LINGET";
+  debugger_symtab[0xA9A5] = "LET";
+  debugger_symtab[0xAA80] = "PRINTN";
+  debugger_symtab[0xAA86] = "CMD";
+  debugger_symtab[0xAAA0] = "PRINT";
+  debugger_symtab[0xAB1E] = "STROUT";
+  debugger_symtab[0xAB47] = "OUTDO";
+  debugger_symtab[0xAB7B] = "GET";
+  debugger_symtab[0xABA5] = "INPUTN";
+  debugger_symtab[0xABBF] = "INPUT";
+  debugger_symtab[0xAC06] = "READ";
+  debugger_symtab[0xAD1E] = "NEXT";
+  debugger_symtab[0xAD8A] = "FRMNUM";
+  debugger_symtab[0xAD9E] = "FRMEVL";
+  debugger_symtab[0xAE83] = "EVAL";
+  debugger_symtab[0xAEF1] = "PARCHK";
+  debugger_symtab[0xAEFF] = "CHKCOM";
+  debugger_symtab[0xAF08] = "SNERR";
+  debugger_symtab[0xAFE6] = "OROP";
+  debugger_symtab[0xAFE9] = "ANDOP";
+  debugger_symtab[0xB016] = "DOREL";
+  debugger_symtab[0xB081] = "DIM";
+  debugger_symtab[0xB08B] = "PTRGET";
+  debugger_symtab[0xB0E7] = "STRNG2";
+  debugger_symtab[0xB11D] = "NOTFNS";
+  debugger_symtab[0xB1BF] = "AYINT";
+  debugger_symtab[0xB1D1] = "ISARY";
+  debugger_symtab[0xB34C] = "UMULT";
+  debugger_symtab[0xB37D] = "FRE";
+  debugger_symtab[0xB391] = "GIVAYF";
+  debugger_symtab[0xB39E] = "POS";
+  debugger_symtab[0xB3B3] = "DEF";
+  debugger_symtab[0xB3F4] = "FNDOER";
+  debugger_symtab[0xB465] = "STRD";
+  debugger_symtab[0xB475] = "STRINI";
+  debugger_symtab[0xB487] = "STRLIT";
+  debugger_symtab[0xB4F4] = "GETSPA";
+  debugger_symtab[0xB526] = "GARBAG";
+  debugger_symtab[0xB63D] = "CAT";
+  debugger_symtab[0xB67A] = "MOVINS";
+  debugger_symtab[0xB6A3] = "FRESTR";
+  debugger_symtab[0xB6EC] = "CHRD";
+  debugger_symtab[0xB700] = "LEFTD";
+  debugger_symtab[0xB72C] = "RIGHTD";
+  debugger_symtab[0xB737] = "MIDD";
+  debugger_symtab[0xB77C] = "LEN";
+  debugger_symtab[0xB78B] = "ASC";
+  debugger_symtab[0xB79B] = "GTBYTC";
+  debugger_symtab[0xB7AD] = "VAL";
+  debugger_symtab[0xB7EB] = "GETNUM";
+  debugger_symtab[0xB7F7] = "GETADR";
+  debugger_symtab[0xB80D] = "PEEK";
+  debugger_symtab[0xB824] = "POKE";
+  debugger_symtab[0xB82D] = "FNWAIT";
+  debugger_symtab[0xB849] = "FADDH";
+  debugger_symtab[0xB850] = "FSUB";
+  debugger_symtab[0xB867] = "FADD";
+  debugger_symtab[0xB86A] = "FADDT";
+  debugger_symtab[0xB8FE] = "NORMAL";
+  debugger_symtab[0xB947] = "NEGFAC";
+  debugger_symtab[0xB97E] = "OVERR";
+  debugger_symtab[0xB9EA] = "LOG";
+  debugger_symtab[0xBA28] = "FMULT";
+  debugger_symtab[0xBA2B] = "FMULTT";
+  debugger_symtab[0xBA59] = "MLTPLY";
+  debugger_symtab[0xBA8C] = "CONUPK";
+  debugger_symtab[0xBAE2] = "MUL10";
+  debugger_symtab[0xBAFE] = "DIV10";
+  debugger_symtab[0xBB0F] = "FDIV";
+  debugger_symtab[0xBB12] = "FDIVT";
+  debugger_symtab[0xBBA2] = "MOVFM";
+  debugger_symtab[0xBBD4] = "MOVMF";
+  debugger_symtab[0xBBFC] = "MOVFA";
+  debugger_symtab[0xBC0C] = "MOVAF";
+  debugger_symtab[0xBC1B] = "ROUND";
+  debugger_symtab[0xBC2B] = "SIGN";
+  debugger_symtab[0xBC39] = "SGN";
+  debugger_symtab[0xBC58] = "ABS";
+  debugger_symtab[0xBC5B] = "FCOMP";
+  debugger_symtab[0xBC9B] = "QINT";
+  debugger_symtab[0xBCCC] = "INT";
+  debugger_symtab[0xBCF3] = "FIN";
+  debugger_symtab[0xBDCD] = "LINPRT";
+  debugger_symtab[0xBDDD] = "FOUT";
+  debugger_symtab[0xBF71] = "SQR";
+  debugger_symtab[0xBF7B] = "FPWRT";
+  debugger_symtab[0xBFB4] = "NEGOP";
+  debugger_symtab[0xBFED] = "EXP";
+  debugger_symtab[0xE097] = "RND";
+  debugger_symtab[0xE12A] = "SYS";
+  debugger_symtab[0xE156] = "SAVE";
+  debugger_symtab[0xE165] = "VERIFY";
+  debugger_symtab[0xE168] = "LOAD";
+  debugger_symtab[0xE1BE] = "OPEN";
+  debugger_symtab[0xE1C7] = "CLOSE";
+  debugger_symtab[0xE264] = "COS";
+  debugger_symtab[0xE26B] = "SIN";
+  debugger_symtab[0xE2B4] = "TAN";
+  debugger_symtab[0xE30E] = "ATN";
+  debugger_symtab[0xE37B] = "WARM";
+  debugger_symtab[0xE394] = "INIT";
+  debugger_symtab[0xE544] = "CLSR";
+  debugger_symtab[0xE5B4] = "LP2";
+  debugger_symtab[0xE632] = "LOOP5";
+  debugger_symtab[0xE716] = "PRT";
+  debugger_symtab[0xE8EA] = "SCROL";
+  debugger_symtab[0xEA31] = "KEY";
+  debugger_symtab[0xEA87] = "SCNKEY";
   debugger_symtab[0xED09] = "TALK";
   debugger_symtab[0xED0C] = "LISTN";
   debugger_symtab[0xED11] = "LIST1";
@@ -391,12 +536,30 @@ void debugger_stack_trace_init(void)
   debugger_symtab[0xEEA0] = "DATALO";
   debugger_symtab[0xEEA9] = "DEBPIA";
   debugger_symtab[0xEEB3] = "W1MS";
+  debugger_symtab[0xF13E] = "NGETIN";
+  debugger_symtab[0xF157] = "NBASIN";
+  debugger_symtab[0xF1CA] = "NBSOUT";
+  debugger_symtab[0xF20E] = "NCHKIN";
+  debugger_symtab[0xF250] = "NCKOUT";
+  debugger_symtab[0xF333] = "NCLRCH";
   debugger_symtab[0xF3D5] = "OPENI";
+  debugger_symtab[0xF69B] = "UDTIM";
+  debugger_symtab[0xF6ED] = "NSTOP";
+  debugger_symtab[0xFCE2] = "START";
+  debugger_symtab[0xFE43] = "NMI";
+  debugger_symtab[0xFF48] = "PULS";
   debugger_symtab[0xFFCF] = "BASIN";
 }
 
 
 
+const char *debugger_symbol(uint16_t address)
+{
+  return debugger_symtab[address];
+}
+
+
+
 void debugger_stack_trace_add(uint16_t from, uint16_t to)
 {
   debugger_stack_trace[debugger_stack_trace_index].from = from;
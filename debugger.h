@@ -2,17 +2,53 @@
 #define _DEBUGGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "mos6510.h"
 #include "serial_bus.h"
 #include "mem.h"
+#include "panic.h"
+
+#define DEBUGGER_BREAKPOINT_READ    0
+#define DEBUGGER_BREAKPOINT_WRITE   1
+#define DEBUGGER_BREAKPOINT_EXECUTE 2
+#define DEBUGGER_BREAKPOINT_TYPES   3
+
+/* One bit per address for each breakpoint type. */
+extern uint8_t debugger_breakpoint_map[DEBUGGER_BREAKPOINT_TYPES]
+                                      [(UINT16_MAX + 1) / 8];
+extern int debugger_breakpoint_count;
 
 void debugger_init(void);
 bool debugger(mos6510_t *cpu, mem_t *mem, serial_bus_t *serial_bus);
-void debugger_mem_read(uint16_t address);
-void debugger_mem_write(uint16_t address, uint8_t value);
-void debugger_mem_execute(uint16_t address);
+
+static inline void debugger_breakpoint_check(int type, uint16_t address)
+{
+  if (debugger_breakpoint_count == 0) {
+    return; /* Fast path, nothing armed. */
+  }
+  if (debugger_breakpoint_map[type][address >> 3] & (1 << (address & 0x7))) {
+    debugger_break = true;
+  }
+}
+
+static inline void debugger_mem_read(uint16_t address)
+{
+  debugger_breakpoint_check(DEBUGGER_BREAKPOINT_READ, address);
+}
+
+static inline void debugger_mem_write(uint16_t address, uint8_t value)
+{
+  (void)value; /* Not currently used. */
+  debugger_breakpoint_check(DEBUGGER_BREAKPOINT_WRITE, address);
+}
+
+static inline void debugger_mem_execute(uint16_t address)
+{
+  debugger_breakpoint_check(DEBUGGER_BREAKPOINT_EXECUTE, address);
+}
 
 void debugger_stack_trace_init(void);
+const char *debugger_symbol(uint16_t address);
 void debugger_stack_trace_dump(FILE *fh);
 void debugger_stack_trace_add(uint16_t from, uint16_t to);
 void debugger_stack_trace_rem(void);
@@ -64,6 +64,7 @@ void dormann_test_setup(mos6510_t *cpu, mem_t *mem)
 {
   dormann_test_load(mem, DORMANN_TEST_FILE);
   mem->ram[1] = 0x0; /* Disable bank switching. */
+  mem_bank_update(mem);
   cpu->pc = 0x0400;
 
   mem->ram[0x3469] = TRAP_OPCODE; /* Inject trap code on end of test. */
@@ -57,15 +57,8 @@ int joystick_init(void)
 
 void joystick_execute(void)
 {
-  static int cycle = 0;
   SDL_Event event;
 
-  /* Only run every X cycle. */
-  cycle++;
-  if (cycle % 10000 != 0) {
-    return;
-  }
-
   while (SDL_PollEvent(&event) == 1) {
     switch (event.type) {
     case SDL_QUIT:
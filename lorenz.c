@@ -59,6 +59,7 @@ static void lorenz_test_load(mem_t *mem, const char *filename)
     mem->ram[address] = c;
     address++; /* Just overflow... */
   }
+  mem_code_flush(mem);
   
   fclose(fh);
 }
@@ -132,6 +133,7 @@ void lorenz_test_setup(mos6510_t *cpu, mem_t *mem)
   
   /* Disable bank switching */
   mem->ram[1] = 0x0;
+  mem_bank_update(mem);
   
   /* Initial values */
   mem->ram[0x0002] = 0x00;
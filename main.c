@@ -21,6 +21,10 @@
 #include "console.h"
 #include "joystick.h"
 #include "debugger.h"
+#include "scheduler.h"
+#include "recompile.h"
+#include "basic.h"
+#include "profile.h"
 #include "test.h"
 #ifdef RESID
 #include "resid.h"
@@ -33,6 +37,15 @@
 #define BASIC_ROM "basic"
 #define CHAR_ROM "chargen"
 
+#define CONSOLE_UPDATE_CYCLES 70000
+#define JOYSTICK_UPDATE_CYCLES 35000
+#define SID_FLUSH_CYCLES 1000
+#define SYNC_CYCLES 9852 /* Tuned to approximately PAL C64 speed. */
+
+/* Screen editor loop waiting for a key, blinking the cursor from IRQ. */
+#define KERNAL_INPUT_WAIT_START 0xE5CD
+#define KERNAL_INPUT_WAIT_END   0xE5D4
+
 
 
 static mos6510_t cpu;
@@ -46,6 +59,9 @@ bool debugger_break = false;
 bool warp_mode = false;
 static char panic_msg[80];
 static char *pending_prg = NULL;
+#ifdef RESID
+static uint64_t sid_cycle = 0;
+#endif
 
 
 
@@ -76,6 +92,148 @@ void panic(const char *format, ...)
 
 
 
+/* KERNAL should now be ready for commands. */
+static bool autostart_trap(mos6510_t *cpu, mem_t *mem)
+{
+  int result;
+  (void)cpu;
+
+  if (basic_listing_name(pending_prg)) {
+    result = basic_load_listing(mem, pending_prg);
+  } else {
+    result = mem_load_prg(mem, pending_prg);
+  }
+  if (result != 0) {
+    console_exit();
+    fprintf(stdout, "Loading of PRG '%s' failed!\n", pending_prg);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Inject a RUN command. */
+  mem->ram[0x277] = 'R';
+  mem->ram[0x278] = 'U';
+  mem->ram[0x279] = 'N';
+  mem->ram[0x27A] = '\r';
+  mem->ram[0x27B] = '\r';
+  mem->ram[0xC6] = 5;
+
+  pending_prg = NULL;
+  mos6510_trap_set(KERNAL_INPUT_WAIT_END, NULL);
+  return false;
+}
+
+
+
+static void serial_bus_event(void *data, uint64_t cycle)
+{
+  serial_bus_state_t state = bus.state;
+  (void)data;
+  (void)cycle;
+
+  serial_bus_execute(&bus, &cia2.data_port_a);
+
+  /* Step once per instruction until the bus settles in idle. */
+  if (state != SERIAL_BUS_STATE_IDLE || bus.state != SERIAL_BUS_STATE_IDLE) {
+    scheduler_add(SCHEDULER_EVENT_SERIAL_BUS, scheduler_cycle + 1);
+  }
+}
+
+
+
+#ifdef RESID
+static void sid_flush(void)
+{
+  resid_execute(scheduler_cycle - sid_cycle, warp_mode);
+  sid_cycle = scheduler_cycle;
+}
+
+
+
+static void sid_event(void *data, uint64_t cycle)
+{
+  (void)data;
+  (void)cycle;
+  sid_flush();
+  scheduler_add(SCHEDULER_EVENT_SID, scheduler_cycle + SID_FLUSH_CYCLES);
+}
+
+
+
+static void sid_write_hook(void *dummy, uint16_t address, uint8_t value)
+{
+  sid_flush(); /* Catch up before the register changes. */
+  resid_write_hook(dummy, address, value);
+}
+#endif
+
+
+
+static void console_event(void *data, uint64_t cycle)
+{
+  (void)data;
+  (void)cycle;
+#ifdef CONSOLE_EXTRA_INFO
+  console_extra_info.pc = cpu.pc;
+  console_extra_info.a = cpu.a;
+  console_extra_info.x = cpu.x;
+  console_extra_info.y = cpu.y;
+  console_extra_info.sp = cpu.sp;
+  mos6510_status_sync(&cpu);
+  console_extra_info.sr_n = cpu.sr.n;
+  console_extra_info.sr_v = cpu.sr.v;
+  console_extra_info.sr_b = cpu.sr.b;
+  console_extra_info.sr_d = cpu.sr.d;
+  console_extra_info.sr_i = cpu.sr.i;
+  console_extra_info.sr_z = cpu.sr.z;
+  console_extra_info.sr_c = cpu.sr.c;
+#endif
+  console_execute(&mem, &vic);
+  scheduler_add(SCHEDULER_EVENT_CONSOLE,
+    scheduler_cycle + CONSOLE_UPDATE_CYCLES);
+}
+
+
+
+static void joystick_event(void *data, uint64_t cycle)
+{
+  (void)data;
+  (void)cycle;
+  joystick_execute();
+  scheduler_add(SCHEDULER_EVENT_JOYSTICK,
+    scheduler_cycle + JOYSTICK_UPDATE_CYCLES);
+}
+
+
+
+static bool input_wait(void)
+{
+  /* $00C6 = Length of keyboard buffer. */
+  return cpu.pc >= KERNAL_INPUT_WAIT_START &&
+    cpu.pc <= KERNAL_INPUT_WAIT_END && mem.ram[0xC6] == 0 &&
+    mem.read_page[KERNAL_INPUT_WAIT_START >> 8] ==
+      &mem.rom[KERNAL_INPUT_WAIT_START & 0xFF00];
+}
+
+
+
+static void sync_event(void *data, uint64_t cycle)
+{
+  (void)data;
+  (void)cycle;
+  /* Nothing to hurry for when waiting on the user, even in warp mode. */
+  if (! warp_mode || input_wait()) {
+    pause(); /* Wait for SIGALRM. */
+  }
+#ifdef RESID
+  /* Let reSID control the speed. */
+  scheduler_add(SCHEDULER_EVENT_SYNC, scheduler_cycle + resid_sync());
+#else
+  scheduler_add(SCHEDULER_EVENT_SYNC, scheduler_cycle + SYNC_CYCLES);
+#endif
+}
+
+
+
 static void display_help(const char *progname)
 {
   fprintf(stdout, "Usage: %s <options> [prg]\n", progname);
@@ -85,11 +243,29 @@ static void display_help(const char *progname)
      "  -w        Warp mode, disable real C64 speed emulation.\n"
      "  -8 FILE   Load D64 FILE into disk drive device #8.\n"
      "  -r DIR    Load ROM file from DIR instead of default location.\n"
+     "  -t SIZE   Enable CPU trace on start, keeping SIZE entries.\n"
+     "  -i        Interpreter only, disable the fast CPU core.\n"
+     "  -x        Lockstep mode, check fast CPU core against interpreter.\n"
      "  -l        Run Lorenz CPU test.\n"
      "  -d        Run Dormann CPU test.\n"
+     "  -c FILE   Recompile PRG and the ROMs to C source FILE and exit.\n"
+     "  -n NAMES  Native BASIC routines, comma separated, see below.\n"
+     "  -F COUNT  Check native BASIC floating point on COUNT operands.\n"
+     "  -G        Check native BASIC garbage collection against the ROM.\n"
+     "  -C        Check compiled BASIC statements against the ROM.\n"
+     "  -p FILE   Profile cycles per BASIC line and routine, FILE on exit.\n"
      "\n");
   fprintf(stdout,
     "Specify a PRG file to load it automatically on start.\n"
+    "Files ending with '.bas' are loaded as BASIC text listings instead.\n"
+    "Build with 'make RECOMPILED=FILE' to run the output of -c.\n"
+    "Native BASIC routines are fast but not cycle accurate, available are:\n"
+    "  fp     - Floating point addition, multiplication and division.\n"
+    "  var    - Variable lookup through an index instead of a linear search.\n"
+    "  line   - Line lookup for GOTO and GOSUB through an index.\n"
+    "  gc     - String garbage collection in one pass, not one per string.\n"
+    "  chrget - Reading the next character of program text, skipping spaces.\n"
+    "  compile - Numeric LET, IF, GOTO, POKE and NEXT compiled once and run.\n"
     "Using Ctrl+C will break into debugger, use 'q' from there to quit.\n"
     "\n");
 }
@@ -103,10 +279,16 @@ int main(int argc, char *argv[])
   bool lorenz_test = false;
   char *rom_directory = NULL;
   char *d64_filename = NULL;
+  char *recompile_filename = NULL;
+  char *basic_native = NULL;
+  int basic_fp_count = 0;
+  bool basic_gc_check = false;
+  bool basic_compile_check = false;
+  char *profile_filename = NULL;
   char rom_path[PATH_MAX];
-  int sync_cycle = 0;
+  int trace_size = 0;
 
-  while ((c = getopt(argc, argv, "hbdlr:w8:")) != -1) {
+  while ((c = getopt(argc, argv, "hbc:CdF:Giln:p:r:t:wx8:")) != -1) {
     switch (c) {
     case 'h':
       display_help(argv[0]);
@@ -116,22 +298,58 @@ int main(int argc, char *argv[])
       debugger_break = true;
       break;
 
+    case 'c':
+      recompile_filename = optarg;
+      break;
+
+    case 'C':
+      basic_compile_check = true;
+      break;
+
     case 'd':
       dormann_test = true;
       break;
 
+    case 'F':
+      basic_fp_count = atoi(optarg);
+      break;
+
+    case 'G':
+      basic_gc_check = true;
+      break;
+
+    case 'i':
+      mos6510_mode = MOS6510_MODE_INTERPRETER;
+      break;
+
     case 'l':
       lorenz_test = true;
       break;
 
+    case 'n':
+      basic_native = optarg;
+      break;
+
+    case 'p':
+      profile_filename = optarg;
+      break;
+
     case 'r':
       rom_directory = optarg;
       break;
 
+    case 't':
+      trace_size = atoi(optarg);
+      break;
+
     case 'w':
       warp_mode = true;
       break;
 
+    case 'x':
+      mos6510_mode = MOS6510_MODE_LOCKSTEP;
+      break;
+
     case '8':
       d64_filename = optarg;
       break;
@@ -143,10 +361,19 @@ int main(int argc, char *argv[])
     }
   }
 
-  mos6510_trace_init();
+  if (trace_size > 0) {
+    if (mos6510_trace_init(trace_size) != 0) {
+      fprintf(stdout, "Unable to setup CPU trace with %d entries!\n",
+        trace_size);
+      return EXIT_FAILURE;
+    }
+    mos6510_trace_enable(true);
+  }
   debugger_stack_trace_init();
   panic_msg[0] = '\0';
 
+  scheduler_init();
+  mos6510_init();
   mem_init(&mem);
   cia_init(&cia1, 1);
   cia_init(&cia2, 2);
@@ -158,8 +385,7 @@ int main(int argc, char *argv[])
   if (lorenz_test) {
     lorenz_test_setup(&cpu, &mem);
     while (1) {
-      mos6510_trace_add(&cpu, &mem);
-      mos6510_execute(&cpu, &mem);
+      mos6510_run(&cpu, &mem, &scheduler_cycle, &scheduler_next);
     }
     return EXIT_SUCCESS;
 
@@ -167,8 +393,7 @@ int main(int argc, char *argv[])
   } else if (dormann_test) {
     dormann_test_setup(&cpu, &mem);
     while (1) {
-      mos6510_trace_add(&cpu, &mem);
-      mos6510_execute(&cpu, &mem);
+      mos6510_run(&cpu, &mem, &scheduler_cycle, &scheduler_next);
     }
     return EXIT_SUCCESS;
   }
@@ -195,6 +420,46 @@ int main(int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
+  /* Recompile mode: */
+  if (recompile_filename != NULL) {
+    if (argc <= optind) {
+      fprintf(stdout, "No PRG file to recompile!\n");
+      return EXIT_FAILURE;
+    }
+    if (recompile_prg(&mem, argv[optind], recompile_filename) != 0) {
+      fprintf(stdout, "Recompiling of PRG '%s' failed!\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  /* BASIC floating point check mode: */
+  if (basic_fp_count > 0) {
+    if (basic_fp_test(&cpu, &mem, basic_fp_count) != 0) {
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+  if (basic_native != NULL) {
+    if (basic_native_enable(basic_native) != 0) {
+      fprintf(stdout, "Unknown native BASIC routine in '%s'!\n",
+        basic_native);
+      return EXIT_FAILURE;
+    }
+  }
+  if (basic_gc_check) {
+    basic_gc_check_enable(true);
+  }
+  if (basic_compile_check) {
+    basic_compile_check_enable(true);
+  }
+  if (profile_filename != NULL) {
+    if (profile_init(&mem, profile_filename) != 0) {
+      fprintf(stdout, "Unable to setup profiling!\n");
+      return EXIT_FAILURE;
+    }
+  }
+
   /* Setup CIA connections: */
   mem.cia_read = cia_read_hook;
   mem.cia_write = cia_write_hook;
@@ -215,7 +480,7 @@ int main(int argc, char *argv[])
 #ifdef RESID
   /* Setup reSID. */
   mem.sid_read = resid_read_hook;
-  mem.sid_write = resid_write_hook;
+  mem.sid_write = sid_write_hook;
   if (resid_init() != 0) {
     return EXIT_FAILURE;
   }
@@ -229,6 +494,7 @@ int main(int argc, char *argv[])
   /* Autoload PRG if specified. */
   if (argc > optind) {
     pending_prg = argv[optind];
+    mos6510_trap_set(KERNAL_INPUT_WAIT_END, autostart_trap);
   }
 
   /* Load D64 file if specified. */
@@ -249,36 +515,31 @@ int main(int argc, char *argv[])
   signal(SIGALRM, sig_handler);
   setitimer(ITIMER_REAL, &new, NULL);
 
-  while (1) {
-    mos6510_trace_add(&cpu, &mem);
-    mos6510_execute(&cpu, &mem);
-    sync_cycle += cpu.cycles;
+  /* Setup periodic events, CIA and VIC-II handle their own. */
+  scheduler_attach(SCHEDULER_EVENT_SERIAL_BUS, serial_bus_event, NULL);
+  scheduler_add(SCHEDULER_EVENT_SERIAL_BUS, scheduler_cycle);
 #ifdef RESID
-    resid_execute(cpu.cycles, warp_mode);
+  scheduler_attach(SCHEDULER_EVENT_SID, sid_event, NULL);
+  scheduler_add(SCHEDULER_EVENT_SID, scheduler_cycle + SID_FLUSH_CYCLES);
 #endif
-    while (cpu.cycles > 0) { /* Run once for each CPU clock. */
-      cia_execute(&cia1);
-      cia_execute(&cia2);
-      vic_execute(&vic);
-      cpu.cycles--;
-    }
-    serial_bus_execute(&bus, &cia2.data_port_a);
-#ifdef CONSOLE_EXTRA_INFO
-    console_extra_info.pc = cpu.pc;
-    console_extra_info.a = cpu.a;
-    console_extra_info.x = cpu.x;
-    console_extra_info.y = cpu.y;
-    console_extra_info.sp = cpu.sp;
-    console_extra_info.sr_n = cpu.sr.n;
-    console_extra_info.sr_v = cpu.sr.v;
-    console_extra_info.sr_b = cpu.sr.b;
-    console_extra_info.sr_d = cpu.sr.d;
-    console_extra_info.sr_i = cpu.sr.i;
-    console_extra_info.sr_z = cpu.sr.z;
-    console_extra_info.sr_c = cpu.sr.c;
+  scheduler_attach(SCHEDULER_EVENT_CONSOLE, console_event, NULL);
+  scheduler_add(SCHEDULER_EVENT_CONSOLE,
+    scheduler_cycle + CONSOLE_UPDATE_CYCLES);
+  scheduler_attach(SCHEDULER_EVENT_JOYSTICK, joystick_event, NULL);
+  scheduler_add(SCHEDULER_EVENT_JOYSTICK,
+    scheduler_cycle + JOYSTICK_UPDATE_CYCLES);
+  scheduler_attach(SCHEDULER_EVENT_SYNC, sync_event, NULL);
+  scheduler_add(SCHEDULER_EVENT_SYNC, scheduler_cycle + SYNC_CYCLES);
+
+  while (1) {
+#ifdef RECOMPILED
+    recompiled_run(&cpu, &mem, &scheduler_cycle, &scheduler_next);
+#else
+    mos6510_run(&cpu, &mem, &scheduler_cycle, &scheduler_next);
 #endif
-    console_execute(&mem, &vic);
-    joystick_execute();
+    if (scheduler_cycle >= scheduler_next) {
+      scheduler_execute();
+    }
 
     if (debugger_break) {
 #ifdef RESID
@@ -297,37 +558,6 @@ int main(int argc, char *argv[])
         console_resume();
       }
     }
-
-    if (pending_prg != NULL) {
-      if (cpu.pc == 0xE5D4) { /* KERNAL should now be ready for commands. */
-        if (mem_load_prg(&mem, pending_prg) != 0) {
-          console_exit();
-          fprintf(stdout, "Loading of PRG '%s' failed!\n", pending_prg);
-          return EXIT_FAILURE;
-        }
-
-        /* Inject a RUN command. */
-        mem.ram[0x277] = 'R';
-        mem.ram[0x278] = 'U';
-        mem.ram[0x279] = 'N';
-        mem.ram[0x27A] = '\r';
-        mem.ram[0x27B] = '\r';
-        mem.ram[0xC6] = 5;
-
-        pending_prg = NULL;
-      }
-    }
-
-    if (! warp_mode) {
-#ifdef RESID
-      if (sync_cycle > resid_sync()) { /* Let reSID control the speed. */
-#else
-      if (sync_cycle > 9852) { /* Tuned to approximately PAL C64 speed. */
-#endif
-        sync_cycle = 0;
-        pause(); /* Wait for SIGALRM. */
-      }
-    }
   }
 
   return EXIT_SUCCESS;
@@ -2,10 +2,12 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <ctype.h>
 #include <time.h>
 
 #include "mem.h"
+#include "cia.h"
 #include "vic.h"
 #include "debugger.h"
 
@@ -17,6 +19,7 @@ console_extra_info_t console_extra_info;
 
 static uint8_t io_read(mem_t *mem, uint16_t address)
 {
+  mem->io_count++;
   if (address >= 0xDF00) { /* I/O #2 */
     /* Not implemented. */
 
@@ -53,8 +56,26 @@ static uint8_t io_read(mem_t *mem, uint16_t address)
 
 
 
+static uint8_t io_peek(mem_t *mem, uint16_t address)
+{
+  /* Same as io_read() but must not change any device state. */
+  if (address >= 0xDC00 && address <= 0xDDFF) { /* CIA #1 & #2 */
+    if ((address & 0xF) == CIA_ICR) { /* Cleared on read. */
+      if (address >= 0xDD00) {
+        return (mem->cia2 != NULL) ? ((cia_t *)mem->cia2)->icr_status : 0;
+      } else {
+        return (mem->cia1 != NULL) ? ((cia_t *)mem->cia1)->icr_status : 0;
+      }
+    }
+  }
+  return io_read(mem, address);
+}
+
+
+
 static void io_write(mem_t *mem, uint16_t address, uint8_t value)
 {
+  mem->io_count++;
   if (address >= 0xDF00) { /* I/O #2 */
     /* Not implemented. */
 
@@ -123,52 +144,176 @@ void mem_init(mem_t *mem)
   /* Setup I/O registers in the zero page to default. */
   mem->ram[0] = 0b00000000; /* All inputs! */
   mem->ram[1] = 0b00111111;
+
+  /* No code has been decoded yet. */
+  for (i = 0; i < MEM_PAGES; i++) {
+    mem->code_generation[i] = 0;
+  }
+  memset(mem->code_map, 0, sizeof(mem->code_map));
+  mem->io_count = 0;
+
+  /* Pages below the banked areas always map to RAM, the rest is set up
+     by the bank switching. */
+  for (i = 0; i < MEM_PAGES; i++) {
+    mem->read_page[i]  = &mem->ram[i * 0x100];
+    mem->write_page[i] = &mem->ram[i * 0x100];
+  }
+  mem_bank_update(mem);
 }
 
 
 
-uint8_t mem_read(mem_t *mem, uint16_t address)
+void mem_code_mark(mem_t *mem, uint16_t address)
 {
-  debugger_mem_read(address);
+  /* Writes to this page must now invalidate the decoded code. */
+  mem->code_map[address >> 11] |= 1 << ((address >> 8) & 0x7);
+}
+
 
-  if (address >= 0xA000 && address <= 0xBFFF) {
-    if ((mem->ram[1] & MEM_LORAM) && (mem->ram[1] & MEM_HIRAM)) {
-      return mem->rom[address]; /* BASIC ROM */
+
+void mem_code_flush(mem_t *mem)
+{
+  int i;
+
+  /* Memory was changed behind the back of mem_write(). */
+  for (i = 0; i < MEM_PAGES; i++) {
+    mem->code_generation[i]++;
+  }
+  memset(mem->code_map, 0, sizeof(mem->code_map));
+}
+
+
+
+void mem_bank_update(mem_t *mem)
+{
+  int i;
+  uint8_t *old_page[MEM_PAGES];
+
+  for (i = 0xA0; i < MEM_PAGES; i++) {
+    old_page[i] = mem->read_page[i];
+  }
+
+  /* Start with everything as RAM, then overlay ROM and I/O. */
+  for (i = 0xA0; i < MEM_PAGES; i++) {
+    mem->read_page[i]  = &mem->ram[i * 0x100];
+    mem->write_page[i] = &mem->ram[i * 0x100];
+  }
+
+  if ((mem->ram[1] & MEM_LORAM) && (mem->ram[1] & MEM_HIRAM)) {
+    for (i = 0xA0; i <= 0xBF; i++) {
+      mem->read_page[i] = &mem->rom[i * 0x100]; /* BASIC ROM */
     }
   }
-  if (address >= 0xD000 && address <= 0xDFFF) {
-    if ((mem->ram[1] & MEM_LORAM) || (mem->ram[1] & MEM_HIRAM)) {
+
+  if ((mem->ram[1] & MEM_LORAM) || (mem->ram[1] & MEM_HIRAM)) {
+    for (i = 0xD0; i <= 0xDF; i++) {
       if (mem->ram[1] & MEM_CHAREN) {
-        return io_read(mem, address);
+        mem->read_page[i]  = NULL; /* I/O */
+        mem->write_page[i] = NULL;
       } else {
-        return mem->rom[address]; /* CHAR ROM */
+        mem->read_page[i] = &mem->rom[i * 0x100]; /* CHAR ROM */
       }
     }
   }
-  if (address >= 0xE000 /* && address <= 0xFFFF */) {
-    if (mem->ram[1] & MEM_HIRAM) {
-      return mem->rom[address]; /* KERNAL ROM */
+
+  if (mem->ram[1] & MEM_HIRAM) {
+    for (i = 0xE0; i < MEM_PAGES; i++) {
+      mem->read_page[i] = &mem->rom[i * 0x100]; /* KERNAL ROM */
+    }
+  }
+
+  /* Decoded code from a page that was switched out is no longer valid. */
+  for (i = 0xA0; i < MEM_PAGES; i++) {
+    if (mem->read_page[i] != old_page[i]) {
+      mem->code_generation[i]++;
     }
   }
+}
+
+
+
+uint8_t mem_read(mem_t *mem, uint16_t address)
+{
+  uint8_t *page;
+
+  debugger_mem_read(address);
+
+  page = mem->read_page[address >> 8];
+  if (page != NULL) {
+    return page[address & 0xFF];
+  }
 
-  return mem->ram[address];
+  return io_read(mem, address);
 }
 
 
 
 void mem_write(mem_t *mem, uint16_t address, uint8_t value)
 {
+  uint8_t *page;
+
   debugger_mem_write(address, value);
 
-  if (address >= 0xD000 && address <= 0xDFFF) {
-    if ((mem->ram[1] & MEM_LORAM) || (mem->ram[1] & MEM_HIRAM)) {
-      if (mem->ram[1] & MEM_CHAREN) {
-        return io_write(mem, address, value);
-      }
+  page = mem->write_page[address >> 8];
+  if (page != NULL) {
+    page[address & 0xFF] = value;
+    if (address <= 0x0001) { /* Processor port, rebuild the bank mapping. */
+      mem_bank_update(mem);
+    }
+    /* Only invalidate when the write is to the code actually visible,
+       RAM under ROM is not. */
+    if ((mem->code_map[address >> 11] & (1 << ((address >> 8) & 0x7))) &&
+      mem->read_page[address >> 8] == page) {
+      mem->code_map[address >> 11] &= ~(1 << ((address >> 8) & 0x7));
+      mem->code_generation[address >> 8]++;
     }
+    return;
   }
 
-  mem->ram[address] = value;
+  io_write(mem, address, value);
+}
+
+
+
+uint8_t mem_peek(mem_t *mem, uint16_t address)
+{
+  uint8_t *page;
+
+  page = mem->read_page[address >> 8];
+  if (page != NULL) {
+    return page[address & 0xFF];
+  }
+
+  return io_peek(mem, address);
+}
+
+
+
+void mem_peek_block(mem_t *mem, uint16_t address, uint8_t *buffer,
+  uint32_t length)
+{
+  uint8_t *page;
+  uint32_t chunk;
+
+  while (length > 0) {
+    /* Copy up to the end of the current page in one go. */
+    chunk = 0x100 - (address & 0xFF);
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    page = mem->read_page[address >> 8];
+    if (page != NULL) {
+      memcpy(buffer, &page[address & 0xFF], chunk);
+      address += chunk; /* Just overflow... */
+      buffer += chunk;
+    } else {
+      for (uint32_t i = 0; i < chunk; i++) {
+        *buffer++ = io_peek(mem, address++);
+      }
+    }
+    length -= chunk;
+  }
 }
 
 
@@ -227,6 +372,7 @@ int mem_load_prg(mem_t *mem, const char *filename)
   mem->ram[0x31] = end % 256;
   mem->ram[0x32] = end / 256;
 
+  mem_code_flush(mem);
   fclose(fh);
   return 0;
 }
@@ -237,14 +383,16 @@ static void mem_ram_dump_16(FILE *fh, mem_t *mem, uint16_t start, uint16_t end)
 {
   int i;
   uint16_t address;
+  uint8_t data[16];
 
   fprintf(fh, "$%04x   ", start & 0xFFF0);
+  mem_peek_block(mem, start & 0xFFF0, data, 16);
 
   /* Hex */
   for (i = 0; i < 16; i++) {
     address = (start & 0xFFF0) + i;
     if ((address >= start) && (address <= end)) {
-      fprintf(fh, "%02x ", mem->ram[address]);
+      fprintf(fh, "%02x ", data[i]);
     } else {
       fprintf(fh, "   ");
     }
@@ -257,8 +405,8 @@ static void mem_ram_dump_16(FILE *fh, mem_t *mem, uint16_t start, uint16_t end)
   for (i = 0; i < 16; i++) {
     address = (start & 0xFFF0) + i;
     if ((address >= start) && (address <= end)) {
-      if (isprint(mem->ram[address])) {
-        fprintf(fh, "%c", mem->ram[address]);
+      if (isprint(data[i])) {
+        fprintf(fh, "%c", data[i]);
       } else {
         fprintf(fh, ".");
       }
@@ -8,9 +8,16 @@
 typedef uint8_t (*mem_read_hook_t)(void *, uint16_t);
 typedef void (*mem_write_hook_t)(void *, uint16_t, uint8_t);
 
+#define MEM_PAGES 256
+
 typedef struct mem_s {
   uint8_t ram[UINT16_MAX + 1];
   uint8_t rom[UINT16_MAX + 1];
+  uint8_t *read_page[MEM_PAGES];  /* NULL means I/O area. */
+  uint8_t *write_page[MEM_PAGES]; /* NULL means I/O area. */
+  uint8_t code_map[MEM_PAGES / 8]; /* Pages with predecoded code. */
+  uint32_t code_generation[MEM_PAGES]; /* Bumped when code is modified. */
+  uint32_t io_count; /* Bumped on every I/O access, see CPU lockstep. */
   void *cia1;
   void *cia2;
   void *vic;
@@ -49,8 +56,14 @@ extern console_extra_info_t console_extra_info;
 #define MEM_CHAREN 0b100
 
 void mem_init(mem_t *mem);
+void mem_bank_update(mem_t *mem);
+void mem_code_mark(mem_t *mem, uint16_t address);
+void mem_code_flush(mem_t *mem);
 uint8_t mem_read(mem_t *mem, uint16_t address);
 void mem_write(mem_t *mem, uint16_t address, uint8_t value);
+uint8_t mem_peek(mem_t *mem, uint16_t address);
+void mem_peek_block(mem_t *mem, uint16_t address, uint8_t *buffer,
+  uint32_t length);
 int mem_load_rom(mem_t *mem, const char *filename, uint16_t address);
 int mem_load_prg(mem_t *mem, const char *filename);
 void mem_ram_dump(FILE *fh, mem_t *mem, uint16_t start, uint16_t end);
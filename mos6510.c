@@ -5,13 +5,26 @@
 #include <stdbool.h>
 
 #include "mos6510.h"
+#include "mos6510_trace.h"
 #include "mem.h"
 #include "panic.h"
 #include "debugger.h"
+#include "profile.h"
 
+/* Hot blocks are translated to host code, see mos6510_jit_translate(). */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define MOS6510_JIT
+#include <stdarg.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#endif
 
 
+
+mos6510_mode_t mos6510_mode = MOS6510_MODE_FAST;
+
 static mos6510_opcode_handler_t mos6510_trap_opcode_handler = NULL;
+static uint32_t mos6510_trap_fired = 0; /* Handlers called, any result. */
 
 void mos6510_trap_opcode(uint8_t opcode, mos6510_opcode_handler_t handler)
 {
@@ -21,26 +34,45 @@ void mos6510_trap_opcode(uint8_t opcode, mos6510_opcode_handler_t handler)
 
 
 
+/* Inlined fast path of mem_read(), plain RAM and ROM pages are read
+   straight from the page table. I/O and armed breakpoints take the full
+   path through mem_read(). */
+#ifdef __GNUC__
+__attribute__((always_inline))
+#endif
+static inline uint8_t mos6510_read(mem_t *mem, uint16_t address)
+{
+  uint8_t *page;
+
+  page = mem->read_page[address >> 8];
+  if (page != NULL && debugger_breakpoint_count == 0) {
+    return page[address & 0xFF];
+  }
+  return mem_read(mem, address);
+}
+
+
+
 static uint8_t mos6510_status_get(mos6510_t *cpu, bool b_flag)
 {
-  return ((cpu->sr.n << 7) +
+  return (((cpu->n_result >> 7) << 7) +
           (cpu->sr.v << 6) +
           (1         << 5) +
           (b_flag    << 4) +
           (cpu->sr.d << 3) +
           (cpu->sr.i << 2) +
-          (cpu->sr.z << 1) +
+          ((cpu->z_result == 0) << 1) +
            cpu->sr.c);
 }
 
 static void mos6510_status_set(mos6510_t *cpu, uint8_t flags)
 {
-  cpu->sr.n = (flags >> 7) & 0x1;
+  cpu->n_result = flags & 0x80;
   cpu->sr.v = (flags >> 6) & 0x1;
   cpu->sr.b = 0;
   cpu->sr.d = (flags >> 3) & 0x1;
   cpu->sr.i = (flags >> 2) & 0x1;
-  cpu->sr.z = (flags >> 1) & 0x1;
+  cpu->z_result = (~flags) & 0x2;
   cpu->sr.c =  flags       & 0x1;
 }
 
@@ -58,40 +90,26 @@ static inline uint8_t bin_to_dec(uint8_t value)
 
 
 
+/* The N and Z flags are not computed here, only the value they derive
+   from is kept until something actually looks at them. */
 static inline void flag_zero_other(mos6510_t *cpu, uint8_t value)
 {
-  if (value == 0) {
-    cpu->sr.z = 1;
-  } else {
-    cpu->sr.z = 0;
-  }
+  cpu->z_result = value;
 }
 
 static inline void flag_negative_other(mos6510_t *cpu, uint8_t value)
 {
-  if ((value >> 7) == 1) {
-    cpu->sr.n = 1;
-  } else {
-    cpu->sr.n = 0;
-  }
+  cpu->n_result = value;
 }
 
 static inline void flag_zero_compare(mos6510_t *cpu, uint8_t a, uint8_t b)
 {
-  if (a == b) {
-    cpu->sr.z = 1;
-  } else {
-    cpu->sr.z = 0;
-  }
+  cpu->z_result = a - b;
 }
 
 static inline void flag_negative_compare(mos6510_t *cpu, uint8_t a, uint8_t b)
 {
-  if (((uint8_t)(a - b) >> 7) == 1) {
-    cpu->sr.n = 1;
-  } else {
-    cpu->sr.n = 0;
-  }
+  cpu->n_result = a - b;
 }
 
 static inline void flag_carry_compare(mos6510_t *cpu, uint8_t a, uint8_t b)
@@ -174,80 +192,75 @@ static inline void flag_overflow_bit(mos6510_t *cpu, uint8_t value)
 
 #define OP_PROLOGUE_ABS \
   uint16_t absolute; \
-  absolute  = mem_read(mem, cpu->pc++); \
-  absolute += mem_read(mem, cpu->pc++) * 256;
+  absolute = operand;
 
 #define OP_PROLOGUE_ABSX \
   uint16_t absolute; \
-  absolute  = mem_read(mem, cpu->pc++); \
-  absolute += mem_read(mem, cpu->pc++) * 256; \
+  absolute = operand; \
   absolute += cpu->x;
 
 #define OP_PROLOGUE_ABSY \
   uint16_t absolute; \
-  absolute  = mem_read(mem, cpu->pc++); \
-  absolute += mem_read(mem, cpu->pc++) * 256; \
+  absolute = operand; \
   absolute += cpu->y; \
 
 #define OP_PROLOGUE_ZP \
   uint8_t zeropage; \
-  zeropage = mem_read(mem, cpu->pc++); \
+  zeropage = operand; \
 
 #define OP_PROLOGUE_ZPX \
   uint8_t zeropage; \
-  zeropage  = mem_read(mem, cpu->pc++); \
+  zeropage = operand; \
   zeropage += cpu->x;
 
 #define OP_PROLOGUE_ZPY \
   uint8_t zeropage; \
-  zeropage  = mem_read(mem, cpu->pc++); \
+  zeropage = operand; \
   zeropage += cpu->y;
 
 #define OP_PROLOGUE_ZPYI \
   uint8_t zeropage; \
   uint16_t absolute; \
-  zeropage  = mem_read(mem, cpu->pc++); \
-  absolute  = mem_read(mem, zeropage); \
+  zeropage = operand; \
+  absolute  = mos6510_read(mem, zeropage); \
   zeropage += 1; \
-  absolute += mem_read(mem, zeropage) * 256; \
+  absolute += mos6510_read(mem, zeropage) * 256; \
   absolute += cpu->y;
 
 #define OP_PROLOGUE_ZPIX \
   uint8_t zeropage; \
   uint16_t absolute; \
-  zeropage  = mem_read(mem, cpu->pc++); \
+  zeropage = operand; \
   zeropage += cpu->x; \
-  absolute  = mem_read(mem, zeropage); \
+  absolute  = mos6510_read(mem, zeropage); \
   zeropage += 1; \
-  absolute += mem_read(mem, zeropage) * 256;
+  absolute += mos6510_read(mem, zeropage) * 256;
 
 #define OP_PROLOGUE_ABSX_BOUNDARY_CHECK \
   uint16_t absolute; \
-  absolute  = mem_read(mem, cpu->pc++); \
-  absolute += mem_read(mem, cpu->pc++) * 256; \
+  absolute = operand; \
   if ((absolute & 0xFF00) != ((absolute + cpu->x) & 0xFF00)) cpu->cycles++; \
   absolute += cpu->x;
 
 #define OP_PROLOGUE_ABSY_BOUNDARY_CHECK \
   uint16_t absolute; \
-  absolute  = mem_read(mem, cpu->pc++); \
-  absolute += mem_read(mem, cpu->pc++) * 256; \
+  absolute = operand; \
   if ((absolute & 0xFF00) != ((absolute + cpu->y) & 0xFF00)) cpu->cycles++; \
   absolute += cpu->y; \
 
 #define OP_PROLOGUE_ZPYI_BOUNDARY_CHECK \
   uint8_t zeropage; \
   uint16_t absolute; \
-  zeropage  = mem_read(mem, cpu->pc++); \
-  absolute  = mem_read(mem, zeropage); \
+  zeropage = operand; \
+  absolute  = mos6510_read(mem, zeropage); \
   zeropage += 1; \
-  absolute += mem_read(mem, zeropage) * 256; \
+  absolute += mos6510_read(mem, zeropage) * 256; \
   if ((absolute & 0xFF00) != ((absolute + cpu->y) & 0xFF00)) cpu->cycles++; \
   absolute += cpu->y;
 
 
 
-static inline void mos6510_logic_adc(mos6510_t *cpu, uint8_t value)
+static void mos6510_logic_adc_reference(mos6510_t *cpu, uint8_t value)
 {
   uint8_t initial;
   bool bit;
@@ -271,7 +284,7 @@ static inline void mos6510_logic_adc(mos6510_t *cpu, uint8_t value)
   flag_zero_other(cpu, cpu->a);
 }
 
-static inline void mos6510_logic_sbc(mos6510_t *cpu, uint8_t value)
+static void mos6510_logic_sbc_reference(mos6510_t *cpu, uint8_t value)
 {
   uint8_t initial;
   bool bit;
@@ -299,129 +312,166 @@ static inline void mos6510_logic_sbc(mos6510_t *cpu, uint8_t value)
 
 
 
+/* Results of ADC and SBC with the C and V flags, indexed by the D and C
+   flags, A and the operand. Generated from the functions above on init. */
+#define MOS6510_ALU_INDEX(d, c, a, value) \
+  (((d) << 17) | ((c) << 16) | ((a) << 8) | (value))
+#define MOS6510_ALU_SIZE (4 * 65536)
+#define MOS6510_ALU_CARRY    0x100
+#define MOS6510_ALU_OVERFLOW 0x200
+
+static uint16_t mos6510_alu_adc[MOS6510_ALU_SIZE];
+static uint16_t mos6510_alu_sbc[MOS6510_ALU_SIZE];
+
+static inline void mos6510_logic_alu(mos6510_t *cpu, uint16_t result)
+{
+  cpu->a = result;
+  cpu->sr.c = (result & MOS6510_ALU_CARRY) != 0;
+  cpu->sr.v = (result & MOS6510_ALU_OVERFLOW) != 0;
+  flag_negative_other(cpu, cpu->a);
+  flag_zero_other(cpu, cpu->a);
+}
+
+static inline void mos6510_logic_adc(mos6510_t *cpu, uint8_t value)
+{
+  mos6510_logic_alu(cpu, mos6510_alu_adc[
+    MOS6510_ALU_INDEX(cpu->sr.d, cpu->sr.c, cpu->a, value)]);
+}
+
+static inline void mos6510_logic_sbc(mos6510_t *cpu, uint8_t value)
+{
+  mos6510_logic_alu(cpu, mos6510_alu_sbc[
+    MOS6510_ALU_INDEX(cpu->sr.d, cpu->sr.c, cpu->a, value)]);
+}
+
+
+
 /* Documented Opcodes */
 
-static void op_adc_imm(mos6510_t *cpu, mem_t *mem)
+static void op_adc_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_abs(mos6510_t *cpu, mem_t *mem)
+static void op_adc_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_absx(mos6510_t *cpu, mem_t *mem)
+static void op_adc_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_absy(mos6510_t *cpu, mem_t *mem)
+static void op_adc_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_zp(mos6510_t *cpu, mem_t *mem)
+static void op_adc_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_adc_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_adc_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_adc_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_adc_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_and_imm(mos6510_t *cpu, mem_t *mem)
+static void op_and_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->a &= mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->a &= operand;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_abs(mos6510_t *cpu, mem_t *mem)
+static void op_and_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_absx(mos6510_t *cpu, mem_t *mem)
+static void op_and_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_absy(mos6510_t *cpu, mem_t *mem)
+static void op_and_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_zp(mos6510_t *cpu, mem_t *mem)
+static void op_and_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->a &= mem_read(mem, zeropage);
+  cpu->a &= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_and_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  cpu->a &= mem_read(mem, zeropage);
+  cpu->a &= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_and_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_and_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_and_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_asl_accu(mos6510_t *cpu, mem_t *mem)
+static void op_asl_accu(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   uint8_t value = cpu->a;
   bool bit = value & 0b10000000;
   value = value << 1;
@@ -431,10 +481,10 @@ static void op_asl_accu(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_asl_abs(mos6510_t *cpu, mem_t *mem)
+static void op_asl_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
@@ -443,10 +493,10 @@ static void op_asl_abs(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_asl_absx(mos6510_t *cpu, mem_t *mem)
+static void op_asl_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
@@ -455,10 +505,10 @@ static void op_asl_absx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_asl_zp(mos6510_t *cpu, mem_t *mem)
+static void op_asl_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, zeropage, value);
@@ -467,10 +517,10 @@ static void op_asl_zp(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_asl_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_asl_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, zeropage, value);
@@ -479,9 +529,10 @@ static void op_asl_zpx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_bcc(mos6510_t *cpu, mem_t *mem)
+static void op_bcc(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
+  (void)mem;
+  int8_t relative = operand;
   if (cpu->sr.c == 0) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
@@ -491,9 +542,10 @@ static void op_bcc(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_bcs(mos6510_t *cpu, mem_t *mem)
+static void op_bcs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
+  (void)mem;
+  int8_t relative = operand;
   if (cpu->sr.c == 1) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
@@ -503,10 +555,11 @@ static void op_bcs(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_beq(mos6510_t *cpu, mem_t *mem)
+static void op_beq(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
-  if (cpu->sr.z == 1) {
+  (void)mem;
+  int8_t relative = operand;
+  if (cpu->z_result == 0) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
       cpu->cycles++; /* Crossed a page boundary. */
@@ -515,30 +568,31 @@ static void op_beq(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_bit_abs(mos6510_t *cpu, mem_t *mem)
+static void op_bit_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_overflow_bit(cpu, value);
   flag_negative_other(cpu, value);
   value &= cpu->a;
   flag_zero_other(cpu, value);
 }
 
-static void op_bit_zp(mos6510_t *cpu, mem_t *mem)
+static void op_bit_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   flag_overflow_bit(cpu, value);
   flag_negative_other(cpu, value);
   value &= cpu->a;
   flag_zero_other(cpu, value);
 }
 
-static void op_bmi(mos6510_t *cpu, mem_t *mem)
+static void op_bmi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
-  if (cpu->sr.n == 1) {
+  (void)mem;
+  int8_t relative = operand;
+  if (cpu->n_result & 0x80) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
       cpu->cycles++; /* Crossed a page boundary. */
@@ -547,10 +601,11 @@ static void op_bmi(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_bne(mos6510_t *cpu, mem_t *mem)
+static void op_bne(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
-  if (cpu->sr.z == 0) {
+  (void)mem;
+  int8_t relative = operand;
+  if (cpu->z_result != 0) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
       cpu->cycles++; /* Crossed a page boundary. */
@@ -559,10 +614,11 @@ static void op_bne(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_bpl(mos6510_t *cpu, mem_t *mem)
+static void op_bpl(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
-  if (cpu->sr.n == 0) {
+  (void)mem;
+  int8_t relative = operand;
+  if ((cpu->n_result & 0x80) == 0) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
       cpu->cycles++; /* Crossed a page boundary. */
@@ -571,20 +627,22 @@ static void op_bpl(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_brk(mos6510_t *cpu, mem_t *mem)
+static void op_brk(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
+  (void)operand;
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, (cpu->pc + 1) / 256);
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, (cpu->pc + 1) % 256);
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, mos6510_status_get(cpu, 1));
   cpu->sr.i = 1;
   cpu->sr.b = 1;
-  cpu->pc  = mem_read(mem, MOS6510_VECTOR_IRQ_LOW);
-  cpu->pc += mem_read(mem, MOS6510_VECTOR_IRQ_HIGH) * 256;
+  cpu->pc  = mos6510_read(mem, MOS6510_VECTOR_IRQ_LOW);
+  cpu->pc += mos6510_read(mem, MOS6510_VECTOR_IRQ_HIGH) * 256;
 }
 
-static void op_bvc(mos6510_t *cpu, mem_t *mem)
+static void op_bvc(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
+  (void)mem;
+  int8_t relative = operand;
   if (cpu->sr.v == 0) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
@@ -594,9 +652,10 @@ static void op_bvc(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_bvs(mos6510_t *cpu, mem_t *mem)
+static void op_bvs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  int8_t relative = mem_read(mem, cpu->pc++);
+  (void)mem;
+  int8_t relative = operand;
   if (cpu->sr.v == 1) {
     cpu->cycles++;
     if ((cpu->pc & 0xFF00) != ((cpu->pc + relative) & 0xFF00)) {
@@ -606,347 +665,360 @@ static void op_bvs(mos6510_t *cpu, mem_t *mem)
   }
 }
 
-static void op_clc(mos6510_t *cpu, mem_t *mem)
+static void op_clc(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.c = 0;
 }
 
-static void op_cld(mos6510_t *cpu, mem_t *mem)
+static void op_cld(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.d = 0;
 }
 
-static void op_cli(mos6510_t *cpu, mem_t *mem)
+static void op_cli(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.i = 0;
 }
 
-static void op_clv(mos6510_t *cpu, mem_t *mem)
+static void op_clv(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.v = 0;
 }
 
-static void op_cmp_imm(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_abs(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_absx(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_absy(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_zp(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cmp_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_cmp_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->a, value);
   flag_zero_compare(cpu, cpu->a, value);
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_cpx_imm(mos6510_t *cpu, mem_t *mem)
+static void op_cpx_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   flag_negative_compare(cpu, cpu->x, value);
   flag_zero_compare(cpu, cpu->x, value);
   flag_carry_compare(cpu, cpu->x, value);
 }
 
-static void op_cpx_abs(mos6510_t *cpu, mem_t *mem)
+static void op_cpx_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->x, value);
   flag_zero_compare(cpu, cpu->x, value);
   flag_carry_compare(cpu, cpu->x, value);
 }
 
-static void op_cpx_zp(mos6510_t *cpu, mem_t *mem)
+static void op_cpx_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   flag_negative_compare(cpu, cpu->x, value);
   flag_zero_compare(cpu, cpu->x, value);
   flag_carry_compare(cpu, cpu->x, value);
 }
 
-static void op_cpy_imm(mos6510_t *cpu, mem_t *mem)
+static void op_cpy_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   flag_negative_compare(cpu, cpu->y, value);
   flag_zero_compare(cpu, cpu->y, value);
   flag_carry_compare(cpu, cpu->y, value);
 }
 
-static void op_cpy_abs(mos6510_t *cpu, mem_t *mem)
+static void op_cpy_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   flag_negative_compare(cpu, cpu->y, value);
   flag_zero_compare(cpu, cpu->y, value);
   flag_carry_compare(cpu, cpu->y, value);
 }
 
-static void op_cpy_zp(mos6510_t *cpu, mem_t *mem)
+static void op_cpy_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   flag_negative_compare(cpu, cpu->y, value);
   flag_zero_compare(cpu, cpu->y, value);
   flag_carry_compare(cpu, cpu->y, value);
 }
 
-static void op_dec_abs(mos6510_t *cpu, mem_t *mem)
+static void op_dec_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_dec_absx(mos6510_t *cpu, mem_t *mem)
+static void op_dec_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_dec_zp(mos6510_t *cpu, mem_t *mem)
+static void op_dec_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value -= 1;
   mem_write(mem, zeropage, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_dec_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_dec_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value -= 1;
   mem_write(mem, zeropage, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_dex(mos6510_t *cpu, mem_t *mem)
+static void op_dex(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->x--;
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_dey(mos6510_t *cpu, mem_t *mem)
+static void op_dey(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->y--;
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_eor_imm(mos6510_t *cpu, mem_t *mem)
+static void op_eor_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->a ^= mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->a ^= operand;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_abs(mos6510_t *cpu, mem_t *mem)
+static void op_eor_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_absx(mos6510_t *cpu, mem_t *mem)
+static void op_eor_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_absy(mos6510_t *cpu, mem_t *mem)
+static void op_eor_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_zp(mos6510_t *cpu, mem_t *mem)
+static void op_eor_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->a ^= mem_read(mem, zeropage);
+  cpu->a ^= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_eor_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  cpu->a ^= mem_read(mem, zeropage);
+  cpu->a ^= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_eor_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_eor_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_eor_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_inc_abs(mos6510_t *cpu, mem_t *mem)
+static void op_inc_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_inc_absx(mos6510_t *cpu, mem_t *mem)
+static void op_inc_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_inc_zp(mos6510_t *cpu, mem_t *mem)
+static void op_inc_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value += 1;
   mem_write(mem, zeropage, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_inc_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_inc_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value += 1;
   mem_write(mem, zeropage, value);
   flag_negative_other(cpu, value);
   flag_zero_other(cpu, value);
 }
 
-static void op_inx(mos6510_t *cpu, mem_t *mem)
+static void op_inx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->x++;
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_iny(mos6510_t *cpu, mem_t *mem)
+static void op_iny(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->y++;
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_jmp_abs(mos6510_t *cpu, mem_t *mem)
+static void op_jmp_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
+  (void)mem;
   cpu->pc = absolute;
 }
 
-static void op_jmp_absi(mos6510_t *cpu, mem_t *mem)
+static void op_jmp_absi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint16_t address = mem_read(mem, absolute);
+  uint16_t address = mos6510_read(mem, absolute);
   absolute += 1;
   if ((absolute & 0xFF) == 0) { /* Page crossing bug. */
     absolute -= 0x100;
   }
-  address += mem_read(mem, absolute) * 256;
+  address += mos6510_read(mem, absolute) * 256;
   cpu->pc = address;
 }
 
-static void op_jsr(mos6510_t *cpu, mem_t *mem)
+static void op_jsr(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
   debugger_stack_trace_add(cpu->pc - 3, absolute);
@@ -955,150 +1027,154 @@ static void op_jsr(mos6510_t *cpu, mem_t *mem)
   cpu->pc = absolute;
 }
 
-static void op_lda_imm(mos6510_t *cpu, mem_t *mem)
+static void op_lda_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->a = mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->a = operand;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_abs(mos6510_t *cpu, mem_t *mem)
+static void op_lda_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->a = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_absx(mos6510_t *cpu, mem_t *mem)
+static void op_lda_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  cpu->a = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_absy(mos6510_t *cpu, mem_t *mem)
+static void op_lda_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->a = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_zp(mos6510_t *cpu, mem_t *mem)
+static void op_lda_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->a = mem_read(mem, zeropage);
+  cpu->a = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_lda_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  cpu->a = mem_read(mem, zeropage);
+  cpu->a = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_lda_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  cpu->a = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lda_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_lda_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  cpu->a = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ldx_imm(mos6510_t *cpu, mem_t *mem)
+static void op_ldx_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->x = mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->x = operand;
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_ldx_abs(mos6510_t *cpu, mem_t *mem)
+static void op_ldx_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->x = mem_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_ldx_absy(mos6510_t *cpu, mem_t *mem)
+static void op_ldx_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->x = mem_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_ldx_zp(mos6510_t *cpu, mem_t *mem)
+static void op_ldx_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->x = mem_read(mem, zeropage);
+  cpu->x = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_ldx_zpy(mos6510_t *cpu, mem_t *mem)
+static void op_ldx_zpy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPY
-  cpu->x = mem_read(mem, zeropage);
+  cpu->x = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_ldy_imm(mos6510_t *cpu, mem_t *mem)
+static void op_ldy_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->y = mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->y = operand;
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_ldy_abs(mos6510_t *cpu, mem_t *mem)
+static void op_ldy_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->y = mem_read(mem, absolute);
+  cpu->y = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_ldy_absx(mos6510_t *cpu, mem_t *mem)
+static void op_ldy_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  cpu->y = mem_read(mem, absolute);
+  cpu->y = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_ldy_zp(mos6510_t *cpu, mem_t *mem)
+static void op_ldy_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->y = mem_read(mem, zeropage);
+  cpu->y = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_ldy_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_ldy_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  cpu->y = mem_read(mem, zeropage);
+  cpu->y = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_lsr_accu(mos6510_t *cpu, mem_t *mem)
+static void op_lsr_accu(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   uint8_t value = cpu->a;
   bool bit = value & 0b00000001;
   value = value >> 1;
@@ -1108,10 +1184,10 @@ static void op_lsr_accu(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_lsr_abs(mos6510_t *cpu, mem_t *mem)
+static void op_lsr_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
@@ -1120,10 +1196,10 @@ static void op_lsr_abs(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_lsr_absx(mos6510_t *cpu, mem_t *mem)
+static void op_lsr_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
@@ -1132,10 +1208,10 @@ static void op_lsr_absx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_lsr_zp(mos6510_t *cpu, mem_t *mem)
+static void op_lsr_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, zeropage, value);
@@ -1144,10 +1220,10 @@ static void op_lsr_zp(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_lsr_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_lsr_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, zeropage, value);
@@ -1156,100 +1232,107 @@ static void op_lsr_zpx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_nop(mos6510_t *cpu, mem_t *mem)
+static void op_nop(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)cpu;
   (void)mem;
+  (void)operand;
 }
 
-static void op_ora_imm(mos6510_t *cpu, mem_t *mem)
+static void op_ora_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->a |= mem_read(mem, cpu->pc++);
+  (void)mem;
+  cpu->a |= operand;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_abs(mos6510_t *cpu, mem_t *mem)
+static void op_ora_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_absx(mos6510_t *cpu, mem_t *mem)
+static void op_ora_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_absy(mos6510_t *cpu, mem_t *mem)
+static void op_ora_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_zp(mos6510_t *cpu, mem_t *mem)
+static void op_ora_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->a |= mem_read(mem, zeropage);
+  cpu->a |= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_ora_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  cpu->a |= mem_read(mem, zeropage);
+  cpu->a |= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_ora_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ora_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_ora_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_pha(mos6510_t *cpu, mem_t *mem)
+static void op_pha(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
+  (void)operand;
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, cpu->a);
 }
 
-static void op_php(mos6510_t *cpu, mem_t *mem)
+static void op_php(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
+  (void)operand;
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, mos6510_status_get(cpu, 1));
 }
 
-static void op_pla(mos6510_t *cpu, mem_t *mem)
+static void op_pla(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  cpu->a = mem_read(mem, MEM_PAGE_STACK + (++cpu->sp));
+  (void)operand;
+  cpu->a = mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp));
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_plp(mos6510_t *cpu, mem_t *mem)
+static void op_plp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  mos6510_status_set(cpu, mem_read(mem, MEM_PAGE_STACK + (++cpu->sp)));
+  (void)operand;
+  mos6510_status_set(cpu, mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp)));
 }
 
-static void op_rol_accu(mos6510_t *cpu, mem_t *mem)
+static void op_rol_accu(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   uint8_t value = cpu->a;
   bool bit = value & 0b10000000;
   value = value << 1;
@@ -1262,10 +1345,10 @@ static void op_rol_accu(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_rol_abs(mos6510_t *cpu, mem_t *mem)
+static void op_rol_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1277,10 +1360,10 @@ static void op_rol_abs(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_rol_absx(mos6510_t *cpu, mem_t *mem)
+static void op_rol_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1292,10 +1375,10 @@ static void op_rol_absx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_rol_zp(mos6510_t *cpu, mem_t *mem)
+static void op_rol_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1307,10 +1390,10 @@ static void op_rol_zp(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_rol_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_rol_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1322,9 +1405,10 @@ static void op_rol_zpx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_ror_accu(mos6510_t *cpu, mem_t *mem)
+static void op_ror_accu(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   uint8_t value = cpu->a;
   bool bit = value & 0b00000001;
   value = value >> 1;
@@ -1337,10 +1421,10 @@ static void op_ror_accu(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_ror_abs(mos6510_t *cpu, mem_t *mem)
+static void op_ror_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -1352,10 +1436,10 @@ static void op_ror_abs(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_ror_absx(mos6510_t *cpu, mem_t *mem)
+static void op_ror_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -1367,10 +1451,10 @@ static void op_ror_absx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_ror_zp(mos6510_t *cpu, mem_t *mem)
+static void op_ror_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -1382,10 +1466,10 @@ static void op_ror_zp(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_ror_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_ror_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -1397,213 +1481,225 @@ static void op_ror_zpx(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_rti(mos6510_t *cpu, mem_t *mem)
+static void op_rti(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  mos6510_status_set(cpu, mem_read(mem, MEM_PAGE_STACK + (++cpu->sp)));
-  cpu->pc  = mem_read(mem, MEM_PAGE_STACK + (++cpu->sp));
-  cpu->pc += mem_read(mem, MEM_PAGE_STACK + (++cpu->sp)) * 256;
+  (void)operand;
+  mos6510_status_set(cpu, mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp)));
+  cpu->pc  = mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp));
+  cpu->pc += mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp)) * 256;
 }
 
-static void op_rts(mos6510_t *cpu, mem_t *mem)
+static void op_rts(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
+  (void)operand;
   debugger_stack_trace_rem();
-  cpu->pc  = mem_read(mem, MEM_PAGE_STACK + (++cpu->sp));
-  cpu->pc += mem_read(mem, MEM_PAGE_STACK + (++cpu->sp)) * 256;
+  cpu->pc  = mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp));
+  cpu->pc += mos6510_read(mem, MEM_PAGE_STACK + (++cpu->sp)) * 256;
   cpu->pc += 1;
 }
 
-static void op_sbc_imm(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_abs(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_absx(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_absy(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_zp(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sbc_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_sbc_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_sec(mos6510_t *cpu, mem_t *mem)
+static void op_sec(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.c = 1;
 }
 
-static void op_sed(mos6510_t *cpu, mem_t *mem)
+static void op_sed(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.d = 1;
 }
 
-static void op_sei(mos6510_t *cpu, mem_t *mem)
+static void op_sei(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sr.i = 1;
 }
 
-static void op_sta_abs(mos6510_t *cpu, mem_t *mem)
+static void op_sta_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
   mem_write(mem, absolute, cpu->a);
 }
 
-static void op_sta_absx(mos6510_t *cpu, mem_t *mem)
+static void op_sta_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
   mem_write(mem, absolute, cpu->a);
 }
 
-static void op_sta_absy(mos6510_t *cpu, mem_t *mem)
+static void op_sta_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
   mem_write(mem, absolute, cpu->a);
 }
 
-static void op_sta_zp(mos6510_t *cpu, mem_t *mem)
+static void op_sta_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
   mem_write(mem, zeropage, cpu->a);
 }
 
-static void op_sta_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_sta_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
   mem_write(mem, zeropage, cpu->a);
 }
 
-static void op_sta_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_sta_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
   mem_write(mem, absolute, cpu->a);
 }
 
-static void op_sta_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_sta_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
   mem_write(mem, absolute, cpu->a);
 }
 
-static void op_stx_abs(mos6510_t *cpu, mem_t *mem)
+static void op_stx_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
   mem_write(mem, absolute, cpu->x);
 }
 
-static void op_stx_zp(mos6510_t *cpu, mem_t *mem)
+static void op_stx_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
   mem_write(mem, zeropage, cpu->x);
 }
 
-static void op_stx_zpy(mos6510_t *cpu, mem_t *mem)
+static void op_stx_zpy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPY
   mem_write(mem, zeropage, cpu->x);
 }
 
-static void op_sty_abs(mos6510_t *cpu, mem_t *mem)
+static void op_sty_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
   mem_write(mem, absolute, cpu->y);
 }
 
-static void op_sty_zp(mos6510_t *cpu, mem_t *mem)
+static void op_sty_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
   mem_write(mem, zeropage, cpu->y);
 }
 
-static void op_sty_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_sty_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
   mem_write(mem, zeropage, cpu->y);
 }
 
-static void op_tax(mos6510_t *cpu, mem_t *mem)
+static void op_tax(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->x = cpu->a;
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_tay(mos6510_t *cpu, mem_t *mem)
+static void op_tay(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->y = cpu->a;
   flag_negative_other(cpu, cpu->y);
   flag_zero_other(cpu, cpu->y);
 }
 
-static void op_tsx(mos6510_t *cpu, mem_t *mem)
+static void op_tsx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->x = cpu->sp;
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_txa(mos6510_t *cpu, mem_t *mem)
+static void op_txa(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->a = cpu->x;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_txs(mos6510_t *cpu, mem_t *mem)
+static void op_txs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->sp = cpu->x;
 }
 
-static void op_tya(mos6510_t *cpu, mem_t *mem)
+static void op_tya(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)mem;
+  (void)operand;
   cpu->a = cpu->y;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
@@ -1613,9 +1709,10 @@ static void op_tya(mos6510_t *cpu, mem_t *mem)
 
 /* Undocumented Opcodes */
 
-static void op_alr_imm(mos6510_t *cpu, mem_t *mem)
+static void op_alr_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   cpu->a &= value;
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
@@ -1628,25 +1725,28 @@ static void op_alr_imm(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, value);
 }
 
-static void op_anc_imm(mos6510_t *cpu, mem_t *mem)
+static void op_anc_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   cpu->a &= value;
   cpu->sr.c = (cpu->a >> 7);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_ane_imm(mos6510_t *cpu, mem_t *mem)
+static void op_ane_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   (void)cpu;
   (void)mem;
+  (void)operand;
   panic("ANE undocumented opcode not implemented!\n");
 }
 
-static void op_arr_imm(mos6510_t *cpu, mem_t *mem)
+static void op_arr_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   bool bit;
   cpu->a &= value;
   cpu->sr.v = ((cpu->a ^ (cpu->a >> 1)) & 0x40) >> 6;
@@ -1658,10 +1758,10 @@ static void op_arr_imm(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_dcp_abs(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1669,10 +1769,10 @@ static void op_dcp_abs(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_absx(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1680,10 +1780,10 @@ static void op_dcp_absx(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_absy(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1691,10 +1791,10 @@ static void op_dcp_absy(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_zp(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value -= 1;
   mem_write(mem, zeropage, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1702,10 +1802,10 @@ static void op_dcp_zp(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value -= 1;
   mem_write(mem, zeropage, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1713,10 +1813,10 @@ static void op_dcp_zpx(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1724,10 +1824,10 @@ static void op_dcp_zpyi(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_dcp_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_dcp_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value -= 1;
   mem_write(mem, absolute, value);
   flag_negative_compare(cpu, cpu->a, value);
@@ -1735,132 +1835,134 @@ static void op_dcp_zpix(mos6510_t *cpu, mem_t *mem)
   flag_carry_compare(cpu, cpu->a, value);
 }
 
-static void op_isc_abs(mos6510_t *cpu, mem_t *mem)
+static void op_isc_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_absx(mos6510_t *cpu, mem_t *mem)
+static void op_isc_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_absy(mos6510_t *cpu, mem_t *mem)
+static void op_isc_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_zp(mos6510_t *cpu, mem_t *mem)
+static void op_isc_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value += 1;
   mem_write(mem, zeropage, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_isc_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   value += 1;
   mem_write(mem, zeropage, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_isc_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_isc_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_isc_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   value += 1;
   mem_write(mem, absolute, value);
   mos6510_logic_sbc(cpu, value);
 }
 
-static void op_las_absy(mos6510_t *cpu, mem_t *mem)
+static void op_las_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
+  (void)mem;
   panic("LAS undocumented opcode not implemented!\n");
 }
 
-static void op_lax_abs(mos6510_t *cpu, mem_t *mem)
+static void op_lax_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  cpu->a = mem_read(mem, absolute);
-  cpu->x = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lax_absy(mos6510_t *cpu, mem_t *mem)
+static void op_lax_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY_BOUNDARY_CHECK
-  cpu->a = mem_read(mem, absolute);
-  cpu->x = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lax_zp(mos6510_t *cpu, mem_t *mem)
+static void op_lax_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  cpu->a = mem_read(mem, zeropage);
-  cpu->x = mem_read(mem, zeropage);
+  cpu->a = mos6510_read(mem, zeropage);
+  cpu->x = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_lax_zpy(mos6510_t *cpu, mem_t *mem)
+static void op_lax_zpy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPY
-  cpu->a = mem_read(mem, zeropage);
-  cpu->x = mem_read(mem, zeropage);
+  cpu->a = mos6510_read(mem, zeropage);
+  cpu->x = mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->x);
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_lax_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_lax_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI_BOUNDARY_CHECK
-  cpu->a = mem_read(mem, absolute);
-  cpu->x = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lax_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_lax_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  cpu->a = mem_read(mem, absolute);
-  cpu->x = mem_read(mem, absolute);
+  cpu->a = mos6510_read(mem, absolute);
+  cpu->x = mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_lxa_imm(mos6510_t *cpu, mem_t *mem)
+static void op_lxa_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   cpu->a |= 0xFF; /* The magic constant. */
   cpu->a &= value;
   cpu->x = cpu->a;
@@ -1868,37 +1970,46 @@ static void op_lxa_imm(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_nop_imm(mos6510_t *cpu, mem_t *mem)
+static void op_nop_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)cpu;
+  (void)mem;
   (void)value;
 }
 
-static void op_nop_zp(mos6510_t *cpu, mem_t *mem)
+static void op_nop_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
+  (void)cpu;
+  (void)mem;
   (void)zeropage;
 }
 
-static void op_nop_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_nop_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
+  (void)mem;
 }
 
-static void op_nop_abs(mos6510_t *cpu, mem_t *mem)
+static void op_nop_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
+  (void)cpu;
+  (void)mem;
+  (void)absolute;
 }
 
-static void op_nop_absx(mos6510_t *cpu, mem_t *mem)
+static void op_nop_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX_BOUNDARY_CHECK
+  (void)mem;
 }
 
-static void op_rla_abs(mos6510_t *cpu, mem_t *mem)
+static void op_rla_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1906,15 +2017,15 @@ static void op_rla_abs(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_absx(mos6510_t *cpu, mem_t *mem)
+static void op_rla_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1922,15 +2033,15 @@ static void op_rla_absx(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_absy(mos6510_t *cpu, mem_t *mem)
+static void op_rla_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1938,15 +2049,15 @@ static void op_rla_absy(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_zp(mos6510_t *cpu, mem_t *mem)
+static void op_rla_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1954,15 +2065,15 @@ static void op_rla_zp(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, zeropage);
+  cpu->a &= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_rla_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1970,15 +2081,15 @@ static void op_rla_zpx(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, zeropage);
+  cpu->a &= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_rla_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -1986,15 +2097,15 @@ static void op_rla_zpyi(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rla_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_rla_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   if (cpu->sr.c == 1) {
@@ -2002,15 +2113,15 @@ static void op_rla_zpix(mos6510_t *cpu, mem_t *mem)
   }
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a &= mem_read(mem, absolute);
+  cpu->a &= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_rra_abs(mos6510_t *cpu, mem_t *mem)
+static void op_rra_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2021,10 +2132,10 @@ static void op_rra_abs(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_absx(mos6510_t *cpu, mem_t *mem)
+static void op_rra_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2035,10 +2146,10 @@ static void op_rra_absx(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_absy(mos6510_t *cpu, mem_t *mem)
+static void op_rra_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2049,10 +2160,10 @@ static void op_rra_absy(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_zp(mos6510_t *cpu, mem_t *mem)
+static void op_rra_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2063,10 +2174,10 @@ static void op_rra_zp(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_rra_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2077,10 +2188,10 @@ static void op_rra_zpx(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_rra_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2091,10 +2202,10 @@ static void op_rra_zpyi(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_rra_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_rra_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   if (cpu->sr.c == 1) {
@@ -2105,33 +2216,34 @@ static void op_rra_zpix(mos6510_t *cpu, mem_t *mem)
   mos6510_logic_adc(cpu, value);
 }
 
-static void op_sax_abs(mos6510_t *cpu, mem_t *mem)
+static void op_sax_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
   mem_write(mem, absolute, cpu->a & cpu->x);
 }
 
-static void op_sax_zp(mos6510_t *cpu, mem_t *mem)
+static void op_sax_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
   mem_write(mem, zeropage, cpu->a & cpu->x);
 }
 
-static void op_sax_zpy(mos6510_t *cpu, mem_t *mem)
+static void op_sax_zpy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPY
   mem_write(mem, zeropage, cpu->a & cpu->x);
 }
 
-static void op_sax_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_sax_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
   mem_write(mem, absolute, cpu->a & cpu->x);
 }
 
-static void op_sbx_imm(mos6510_t *cpu, mem_t *mem)
+static void op_sbx_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   uint16_t temp;
   temp = (cpu->a & cpu->x) - value;
   cpu->x = temp;
@@ -2140,234 +2252,239 @@ static void op_sbx_imm(mos6510_t *cpu, mem_t *mem)
   flag_zero_other(cpu, cpu->x);
 }
 
-static void op_sha_absy(mos6510_t *cpu, mem_t *mem)
+static void op_sha_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
+  (void)mem;
   panic("SHA (absy) undocumented opcode not implemented!\n");
 }
 
-static void op_sha_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_sha_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
   panic("SHA (zpyi) undocumented opcode not implemented!\n");
 }
 
-static void op_shx_absy(mos6510_t *cpu, mem_t *mem)
+static void op_shx_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
   absolute = ((cpu->x & ((absolute >> 8) + 1)) << 8) | (absolute & 0xff);
   mem_write(mem, absolute, absolute >> 8);
 }
 
-static void op_shy_absx(mos6510_t *cpu, mem_t *mem)
+static void op_shy_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
   absolute = ((cpu->y & ((absolute >> 8) + 1)) << 8) | (absolute & 0xff);
   mem_write(mem, absolute, absolute >> 8);
 }
 
-static void op_slo_abs(mos6510_t *cpu, mem_t *mem)
+static void op_slo_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_absx(mos6510_t *cpu, mem_t *mem)
+static void op_slo_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_absy(mos6510_t *cpu, mem_t *mem)
+static void op_slo_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_zp(mos6510_t *cpu, mem_t *mem)
+static void op_slo_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, zeropage);
+  cpu->a |= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_slo_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, zeropage);
+  cpu->a |= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_slo_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_slo_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_slo_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b10000000;
   value = value << 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a |= mem_read(mem, absolute);
+  cpu->a |= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_abs(mos6510_t *cpu, mem_t *mem)
+static void op_sre_abs(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABS
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_absx(mos6510_t *cpu, mem_t *mem)
+static void op_sre_absx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_absy(mos6510_t *cpu, mem_t *mem)
+static void op_sre_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_zp(mos6510_t *cpu, mem_t *mem)
+static void op_sre_zp(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZP
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, zeropage);
+  cpu->a ^= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_zpx(mos6510_t *cpu, mem_t *mem)
+static void op_sre_zpx(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPX
-  uint8_t value = mem_read(mem, zeropage);
+  uint8_t value = mos6510_read(mem, zeropage);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, zeropage, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, zeropage);
+  cpu->a ^= mos6510_read(mem, zeropage);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_zpyi(mos6510_t *cpu, mem_t *mem)
+static void op_sre_zpyi(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPYI
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_sre_zpix(mos6510_t *cpu, mem_t *mem)
+static void op_sre_zpix(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ZPIX
-  uint8_t value = mem_read(mem, absolute);
+  uint8_t value = mos6510_read(mem, absolute);
   bool bit = value & 0b00000001;
   value = value >> 1;
   mem_write(mem, absolute, value);
   cpu->sr.c = bit;
-  cpu->a ^= mem_read(mem, absolute);
+  cpu->a ^= mos6510_read(mem, absolute);
   flag_negative_other(cpu, cpu->a);
   flag_zero_other(cpu, cpu->a);
 }
 
-static void op_tas_absy(mos6510_t *cpu, mem_t *mem)
+static void op_tas_absy(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   OP_PROLOGUE_ABSY
+  (void)mem;
   panic("TAS undocumented opcode not implemented!\n");
 }
 
-static void op_usbc_imm(mos6510_t *cpu, mem_t *mem)
+static void op_usbc_imm(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
-  uint8_t value = mem_read(mem, cpu->pc++);
+  uint8_t value = operand;
+  (void)mem;
   mos6510_logic_sbc(cpu, value);
 }
 
 
 
-static void op_none(mos6510_t *cpu, mem_t *mem)
+static void op_none(mos6510_t *cpu, mem_t *mem, uint16_t operand)
 {
   uint8_t opcode;
-  opcode = mem_read(mem, cpu->pc - 1);
+  (void)operand;
+  opcode = mos6510_read(mem, cpu->pc - 1);
 
   if (mos6510_trap_opcode_handler != NULL) {
+    mos6510_trap_fired++;
     if (true == (mos6510_trap_opcode_handler)(opcode, cpu, mem)) {
       /* Request was handled...  */
       return;
@@ -2378,127 +2495,1508 @@ static void op_none(mos6510_t *cpu, mem_t *mem)
 
 
 
-typedef void (*mos6510_operation_func_t)(mos6510_t *, mem_t *);
-
+/* Opcode description: opcode, handler, length and base cycles when page
+   boundary crossing is not considered. The tables and the threaded
+   interpreter below are all generated from this one list. */
+#define MOS6510_OPCODES \
+  OPCODE(0x00, brk,      1, 7) \
+  OPCODE(0x01, ora_zpix, 2, 6) \
+  OPCODE(0x02, none,     1, 0) \
+  OPCODE(0x03, slo_zpix, 2, 8) \
+  OPCODE(0x04, nop_zp,   2, 3) \
+  OPCODE(0x05, ora_zp,   2, 3) \
+  OPCODE(0x06, asl_zp,   2, 5) \
+  OPCODE(0x07, slo_zp,   2, 5) \
+  OPCODE(0x08, php,      1, 3) \
+  OPCODE(0x09, ora_imm,  2, 2) \
+  OPCODE(0x0A, asl_accu, 1, 2) \
+  OPCODE(0x0B, anc_imm,  2, 2) \
+  OPCODE(0x0C, nop_abs,  3, 4) \
+  OPCODE(0x0D, ora_abs,  3, 4) \
+  OPCODE(0x0E, asl_abs,  3, 6) \
+  OPCODE(0x0F, slo_abs,  3, 6) \
+  OPCODE(0x10, bpl,      2, 2) \
+  OPCODE(0x11, ora_zpyi, 2, 5) \
+  OPCODE(0x12, none,     1, 0) \
+  OPCODE(0x13, slo_zpyi, 2, 8) \
+  OPCODE(0x14, nop_zpx,  2, 4) \
+  OPCODE(0x15, ora_zpx,  2, 4) \
+  OPCODE(0x16, asl_zpx,  2, 6) \
+  OPCODE(0x17, slo_zpx,  2, 6) \
+  OPCODE(0x18, clc,      1, 2) \
+  OPCODE(0x19, ora_absy, 3, 4) \
+  OPCODE(0x1A, nop,      1, 2) \
+  OPCODE(0x1B, slo_absy, 3, 7) \
+  OPCODE(0x1C, nop_absx, 3, 4) \
+  OPCODE(0x1D, ora_absx, 3, 4) \
+  OPCODE(0x1E, asl_absx, 3, 7) \
+  OPCODE(0x1F, slo_absx, 3, 7) \
+  OPCODE(0x20, jsr,      3, 6) \
+  OPCODE(0x21, and_zpix, 2, 6) \
+  OPCODE(0x22, none,     1, 0) \
+  OPCODE(0x23, rla_zpix, 2, 8) \
+  OPCODE(0x24, bit_zp,   2, 3) \
+  OPCODE(0x25, and_zp,   2, 3) \
+  OPCODE(0x26, rol_zp,   2, 5) \
+  OPCODE(0x27, rla_zp,   2, 5) \
+  OPCODE(0x28, plp,      1, 4) \
+  OPCODE(0x29, and_imm,  2, 2) \
+  OPCODE(0x2A, rol_accu, 1, 2) \
+  OPCODE(0x2B, anc_imm,  2, 2) \
+  OPCODE(0x2C, bit_abs,  3, 4) \
+  OPCODE(0x2D, and_abs,  3, 4) \
+  OPCODE(0x2E, rol_abs,  3, 6) \
+  OPCODE(0x2F, rla_abs,  3, 6) \
+  OPCODE(0x30, bmi,      2, 2) \
+  OPCODE(0x31, and_zpyi, 2, 5) \
+  OPCODE(0x32, none,     1, 0) \
+  OPCODE(0x33, rla_zpyi, 2, 8) \
+  OPCODE(0x34, nop_zpx,  2, 4) \
+  OPCODE(0x35, and_zpx,  2, 4) \
+  OPCODE(0x36, rol_zpx,  2, 6) \
+  OPCODE(0x37, rla_zpx,  2, 6) \
+  OPCODE(0x38, sec,      1, 2) \
+  OPCODE(0x39, and_absy, 3, 4) \
+  OPCODE(0x3A, nop,      1, 2) \
+  OPCODE(0x3B, rla_absy, 3, 7) \
+  OPCODE(0x3C, nop_absx, 3, 4) \
+  OPCODE(0x3D, and_absx, 3, 4) \
+  OPCODE(0x3E, rol_absx, 3, 7) \
+  OPCODE(0x3F, rla_absx, 3, 7) \
+  OPCODE(0x40, rti,      1, 6) \
+  OPCODE(0x41, eor_zpix, 2, 6) \
+  OPCODE(0x42, none,     1, 0) \
+  OPCODE(0x43, sre_zpix, 2, 8) \
+  OPCODE(0x44, nop_zp,   2, 3) \
+  OPCODE(0x45, eor_zp,   2, 3) \
+  OPCODE(0x46, lsr_zp,   2, 5) \
+  OPCODE(0x47, sre_zp,   2, 5) \
+  OPCODE(0x48, pha,      1, 3) \
+  OPCODE(0x49, eor_imm,  2, 2) \
+  OPCODE(0x4A, lsr_accu, 1, 2) \
+  OPCODE(0x4B, alr_imm,  2, 2) \
+  OPCODE(0x4C, jmp_abs,  3, 3) \
+  OPCODE(0x4D, eor_abs,  3, 4) \
+  OPCODE(0x4E, lsr_abs,  3, 6) \
+  OPCODE(0x4F, sre_abs,  3, 6) \
+  OPCODE(0x50, bvc,      2, 2) \
+  OPCODE(0x51, eor_zpyi, 2, 5) \
+  OPCODE(0x52, none,     1, 0) \
+  OPCODE(0x53, sre_zpyi, 2, 8) \
+  OPCODE(0x54, nop_zpx,  2, 4) \
+  OPCODE(0x55, eor_zpx,  2, 4) \
+  OPCODE(0x56, lsr_zpx,  2, 6) \
+  OPCODE(0x57, sre_zpx,  2, 6) \
+  OPCODE(0x58, cli,      1, 2) \
+  OPCODE(0x59, eor_absy, 3, 4) \
+  OPCODE(0x5A, nop,      1, 2) \
+  OPCODE(0x5B, sre_absy, 3, 7) \
+  OPCODE(0x5C, nop_absx, 3, 4) \
+  OPCODE(0x5D, eor_absx, 3, 4) \
+  OPCODE(0x5E, lsr_absx, 3, 7) \
+  OPCODE(0x5F, sre_absx, 3, 7) \
+  OPCODE(0x60, rts,      1, 6) \
+  OPCODE(0x61, adc_zpix, 2, 6) \
+  OPCODE(0x62, none,     1, 0) \
+  OPCODE(0x63, rra_zpix, 2, 8) \
+  OPCODE(0x64, nop_zp,   2, 3) \
+  OPCODE(0x65, adc_zp,   2, 3) \
+  OPCODE(0x66, ror_zp,   2, 5) \
+  OPCODE(0x67, rra_zp,   2, 5) \
+  OPCODE(0x68, pla,      1, 4) \
+  OPCODE(0x69, adc_imm,  2, 2) \
+  OPCODE(0x6A, ror_accu, 1, 2) \
+  OPCODE(0x6B, arr_imm,  2, 2) \
+  OPCODE(0x6C, jmp_absi, 3, 5) \
+  OPCODE(0x6D, adc_abs,  3, 4) \
+  OPCODE(0x6E, ror_abs,  3, 6) \
+  OPCODE(0x6F, rra_abs,  3, 6) \
+  OPCODE(0x70, bvs,      2, 2) \
+  OPCODE(0x71, adc_zpyi, 2, 5) \
+  OPCODE(0x72, none,     1, 0) \
+  OPCODE(0x73, rra_zpyi, 2, 8) \
+  OPCODE(0x74, nop_zpx,  2, 4) \
+  OPCODE(0x75, adc_zpx,  2, 4) \
+  OPCODE(0x76, ror_zpx,  2, 6) \
+  OPCODE(0x77, rra_zpx,  2, 6) \
+  OPCODE(0x78, sei,      1, 2) \
+  OPCODE(0x79, adc_absy, 3, 4) \
+  OPCODE(0x7A, nop,      1, 2) \
+  OPCODE(0x7B, rra_absy, 3, 7) \
+  OPCODE(0x7C, nop_absx, 3, 4) \
+  OPCODE(0x7D, adc_absx, 3, 4) \
+  OPCODE(0x7E, ror_absx, 3, 7) \
+  OPCODE(0x7F, rra_absx, 3, 7) \
+  OPCODE(0x80, nop_imm,  2, 2) \
+  OPCODE(0x81, sta_zpix, 2, 6) \
+  OPCODE(0x82, nop_imm,  2, 2) \
+  OPCODE(0x83, sax_zpix, 2, 6) \
+  OPCODE(0x84, sty_zp,   2, 3) \
+  OPCODE(0x85, sta_zp,   2, 3) \
+  OPCODE(0x86, stx_zp,   2, 3) \
+  OPCODE(0x87, sax_zp,   2, 3) \
+  OPCODE(0x88, dey,      1, 2) \
+  OPCODE(0x89, nop_imm,  2, 2) \
+  OPCODE(0x8A, txa,      1, 2) \
+  OPCODE(0x8B, ane_imm,  2, 2) \
+  OPCODE(0x8C, sty_abs,  3, 4) \
+  OPCODE(0x8D, sta_abs,  3, 4) \
+  OPCODE(0x8E, stx_abs,  3, 4) \
+  OPCODE(0x8F, sax_abs,  3, 4) \
+  OPCODE(0x90, bcc,      2, 2) \
+  OPCODE(0x91, sta_zpyi, 2, 6) \
+  OPCODE(0x92, none,     1, 0) \
+  OPCODE(0x93, sha_zpyi, 2, 6) \
+  OPCODE(0x94, sty_zpx,  2, 4) \
+  OPCODE(0x95, sta_zpx,  2, 4) \
+  OPCODE(0x96, stx_zpy,  2, 4) \
+  OPCODE(0x97, sax_zpy,  2, 4) \
+  OPCODE(0x98, tya,      1, 2) \
+  OPCODE(0x99, sta_absy, 3, 5) \
+  OPCODE(0x9A, txs,      1, 2) \
+  OPCODE(0x9B, tas_absy, 3, 5) \
+  OPCODE(0x9C, shy_absx, 3, 5) \
+  OPCODE(0x9D, sta_absx, 3, 5) \
+  OPCODE(0x9E, shx_absy, 3, 5) \
+  OPCODE(0x9F, sha_absy, 3, 5) \
+  OPCODE(0xA0, ldy_imm,  2, 2) \
+  OPCODE(0xA1, lda_zpix, 2, 6) \
+  OPCODE(0xA2, ldx_imm,  2, 2) \
+  OPCODE(0xA3, lax_zpix, 2, 6) \
+  OPCODE(0xA4, ldy_zp,   2, 3) \
+  OPCODE(0xA5, lda_zp,   2, 3) \
+  OPCODE(0xA6, ldx_zp,   2, 3) \
+  OPCODE(0xA7, lax_zp,   2, 3) \
+  OPCODE(0xA8, tay,      1, 2) \
+  OPCODE(0xA9, lda_imm,  2, 2) \
+  OPCODE(0xAA, tax,      1, 2) \
+  OPCODE(0xAB, lxa_imm,  2, 2) \
+  OPCODE(0xAC, ldy_abs,  3, 4) \
+  OPCODE(0xAD, lda_abs,  3, 4) \
+  OPCODE(0xAE, ldx_abs,  3, 4) \
+  OPCODE(0xAF, lax_abs,  3, 4) \
+  OPCODE(0xB0, bcs,      2, 2) \
+  OPCODE(0xB1, lda_zpyi, 2, 5) \
+  OPCODE(0xB2, none,     1, 0) \
+  OPCODE(0xB3, lax_zpyi, 2, 5) \
+  OPCODE(0xB4, ldy_zpx,  2, 4) \
+  OPCODE(0xB5, lda_zpx,  2, 4) \
+  OPCODE(0xB6, ldx_zpy,  2, 4) \
+  OPCODE(0xB7, lax_zpy,  2, 4) \
+  OPCODE(0xB8, clv,      1, 2) \
+  OPCODE(0xB9, lda_absy, 3, 4) \
+  OPCODE(0xBA, tsx,      1, 2) \
+  OPCODE(0xBB, las_absy, 3, 4) \
+  OPCODE(0xBC, ldy_absx, 3, 4) \
+  OPCODE(0xBD, lda_absx, 3, 4) \
+  OPCODE(0xBE, ldx_absy, 3, 4) \
+  OPCODE(0xBF, lax_absy, 3, 4) \
+  OPCODE(0xC0, cpy_imm,  2, 2) \
+  OPCODE(0xC1, cmp_zpix, 2, 6) \
+  OPCODE(0xC2, nop_imm,  2, 2) \
+  OPCODE(0xC3, dcp_zpix, 2, 8) \
+  OPCODE(0xC4, cpy_zp,   2, 3) \
+  OPCODE(0xC5, cmp_zp,   2, 3) \
+  OPCODE(0xC6, dec_zp,   2, 5) \
+  OPCODE(0xC7, dcp_zp,   2, 5) \
+  OPCODE(0xC8, iny,      1, 2) \
+  OPCODE(0xC9, cmp_imm,  2, 2) \
+  OPCODE(0xCA, dex,      1, 2) \
+  OPCODE(0xCB, sbx_imm,  2, 2) \
+  OPCODE(0xCC, cpy_abs,  3, 4) \
+  OPCODE(0xCD, cmp_abs,  3, 4) \
+  OPCODE(0xCE, dec_abs,  3, 6) \
+  OPCODE(0xCF, dcp_abs,  3, 6) \
+  OPCODE(0xD0, bne,      2, 2) \
+  OPCODE(0xD1, cmp_zpyi, 2, 5) \
+  OPCODE(0xD2, none,     1, 0) \
+  OPCODE(0xD3, dcp_zpyi, 2, 8) \
+  OPCODE(0xD4, nop_zpx,  2, 4) \
+  OPCODE(0xD5, cmp_zpx,  2, 4) \
+  OPCODE(0xD6, dec_zpx,  2, 6) \
+  OPCODE(0xD7, dcp_zpx,  2, 6) \
+  OPCODE(0xD8, cld,      1, 2) \
+  OPCODE(0xD9, cmp_absy, 3, 4) \
+  OPCODE(0xDA, nop,      1, 2) \
+  OPCODE(0xDB, dcp_absy, 3, 7) \
+  OPCODE(0xDC, nop_absx, 3, 4) \
+  OPCODE(0xDD, cmp_absx, 3, 4) \
+  OPCODE(0xDE, dec_absx, 3, 7) \
+  OPCODE(0xDF, dcp_absx, 3, 7) \
+  OPCODE(0xE0, cpx_imm,  2, 2) \
+  OPCODE(0xE1, sbc_zpix, 2, 6) \
+  OPCODE(0xE2, nop_imm,  2, 2) \
+  OPCODE(0xE3, isc_zpix, 2, 8) \
+  OPCODE(0xE4, cpx_zp,   2, 3) \
+  OPCODE(0xE5, sbc_zp,   2, 3) \
+  OPCODE(0xE6, inc_zp,   2, 5) \
+  OPCODE(0xE7, isc_zp,   2, 5) \
+  OPCODE(0xE8, inx,      1, 2) \
+  OPCODE(0xE9, sbc_imm,  2, 2) \
+  OPCODE(0xEA, nop,      1, 2) \
+  OPCODE(0xEB, usbc_imm, 2, 2) \
+  OPCODE(0xEC, cpx_abs,  3, 4) \
+  OPCODE(0xED, sbc_abs,  3, 4) \
+  OPCODE(0xEE, inc_abs,  3, 6) \
+  OPCODE(0xEF, isc_abs,  3, 6) \
+  OPCODE(0xF0, beq,      2, 2) \
+  OPCODE(0xF1, sbc_zpyi, 2, 5) \
+  OPCODE(0xF2, none,     1, 0) \
+  OPCODE(0xF3, isc_zpyi, 2, 8) \
+  OPCODE(0xF4, nop_zpx,  2, 4) \
+  OPCODE(0xF5, sbc_zpx,  2, 4) \
+  OPCODE(0xF6, inc_zpx,  2, 6) \
+  OPCODE(0xF7, isc_zpx,  2, 6) \
+  OPCODE(0xF8, sed,      1, 2) \
+  OPCODE(0xF9, sbc_absy, 3, 4) \
+  OPCODE(0xFA, nop,      1, 2) \
+  OPCODE(0xFB, isc_absy, 3, 7) \
+  OPCODE(0xFC, nop_absx, 3, 4) \
+  OPCODE(0xFD, sbc_absx, 3, 4) \
+  OPCODE(0xFE, inc_absx, 3, 7) \
+  OPCODE(0xFF, isc_absx, 3, 7)
+
+
+
+typedef void (*mos6510_operation_func_t)(mos6510_t *, mem_t *, uint16_t);
+
+#define OPCODE(code, name, length, base_cycles) op_##name,
 static mos6510_operation_func_t opcode_function[UINT8_MAX + 1] = {
-  op_brk,      op_ora_zpix, op_none,     op_slo_zpix, /* 0x00 -> 0x03 */
-  op_nop_zp,   op_ora_zp,   op_asl_zp,   op_slo_zp,   /* 0x04 -> 0x07 */
-  op_php,      op_ora_imm,  op_asl_accu, op_anc_imm,  /* 0x08 -> 0x0B */
-  op_nop_abs,  op_ora_abs,  op_asl_abs,  op_slo_abs,  /* 0x0C -> 0x0F */
-  op_bpl,      op_ora_zpyi, op_none,     op_slo_zpyi, /* 0x10 -> 0x13 */
-  op_nop_zpx,  op_ora_zpx,  op_asl_zpx,  op_slo_zpx,  /* 0x14 -> 0x17 */
-  op_clc,      op_ora_absy, op_nop,      op_slo_absy, /* 0x18 -> 0x1B */
-  op_nop_absx, op_ora_absx, op_asl_absx, op_slo_absx, /* 0x1C -> 0x1F */
-  op_jsr,      op_and_zpix, op_none,     op_rla_zpix, /* 0x20 -> 0x23 */
-  op_bit_zp,   op_and_zp,   op_rol_zp,   op_rla_zp,   /* 0x24 -> 0x27 */
-  op_plp,      op_and_imm,  op_rol_accu, op_anc_imm,  /* 0x28 -> 0x2B */
-  op_bit_abs,  op_and_abs,  op_rol_abs,  op_rla_abs,  /* 0x2C -> 0x2F */
-  op_bmi,      op_and_zpyi, op_none,     op_rla_zpyi, /* 0x30 -> 0x33 */
-  op_nop_zpx,  op_and_zpx,  op_rol_zpx,  op_rla_zpx,  /* 0x34 -> 0x37 */
-  op_sec,      op_and_absy, op_nop,      op_rla_absy, /* 0x38 -> 0x3B */
-  op_nop_absx, op_and_absx, op_rol_absx, op_rla_absx, /* 0x3C -> 0x3F */
-  op_rti,      op_eor_zpix, op_none,     op_sre_zpix, /* 0x40 -> 0x43 */
-  op_nop_zp,   op_eor_zp,   op_lsr_zp,   op_sre_zp,   /* 0x44 -> 0x47 */
-  op_pha,      op_eor_imm,  op_lsr_accu, op_alr_imm,  /* 0x48 -> 0x4B */
-  op_jmp_abs,  op_eor_abs,  op_lsr_abs,  op_sre_abs,  /* 0x4C -> 0x4F */
-  op_bvc,      op_eor_zpyi, op_none,     op_sre_zpyi, /* 0x50 -> 0x53 */
-  op_nop_zpx,  op_eor_zpx,  op_lsr_zpx,  op_sre_zpx,  /* 0x54 -> 0x57 */
-  op_cli,      op_eor_absy, op_nop,      op_sre_absy, /* 0x58 -> 0x5B */
-  op_nop_absx, op_eor_absx, op_lsr_absx, op_sre_absx, /* 0x5C -> 0x5F */
-  op_rts,      op_adc_zpix, op_none,     op_rra_zpix, /* 0x60 -> 0x63 */
-  op_nop_zp,   op_adc_zp,   op_ror_zp,   op_rra_zp,   /* 0x64 -> 0x67 */
-  op_pla,      op_adc_imm,  op_ror_accu, op_arr_imm,  /* 0x68 -> 0x6B */
-  op_jmp_absi, op_adc_abs,  op_ror_abs,  op_rra_abs,  /* 0x6C -> 0x6F */
-  op_bvs,      op_adc_zpyi, op_none,     op_rra_zpyi, /* 0x70 -> 0x73 */
-  op_nop_zpx,  op_adc_zpx,  op_ror_zpx,  op_rra_zpx,  /* 0x74 -> 0x77 */
-  op_sei,      op_adc_absy, op_nop,      op_rra_absy, /* 0x78 -> 0x7B */
-  op_nop_absx, op_adc_absx, op_ror_absx, op_rra_absx, /* 0x7C -> 0x7F */
-  op_nop_imm,  op_sta_zpix, op_nop_imm,  op_sax_zpix, /* 0x80 -> 0x83 */
-  op_sty_zp,   op_sta_zp,   op_stx_zp,   op_sax_zp,   /* 0x84 -> 0x87 */
-  op_dey,      op_nop_imm,  op_txa,      op_ane_imm,  /* 0x88 -> 0x8B */
-  op_sty_abs,  op_sta_abs,  op_stx_abs,  op_sax_abs,  /* 0x8C -> 0x8F */
-  op_bcc,      op_sta_zpyi, op_none,     op_sha_zpyi, /* 0x90 -> 0x93 */
-  op_sty_zpx,  op_sta_zpx,  op_stx_zpy,  op_sax_zpy,  /* 0x94 -> 0x97 */
-  op_tya,      op_sta_absy, op_txs,      op_tas_absy, /* 0x98 -> 0x9B */
-  op_shy_absx, op_sta_absx, op_shx_absy, op_sha_absy, /* 0x9C -> 0x9F */
-  op_ldy_imm,  op_lda_zpix, op_ldx_imm,  op_lax_zpix, /* 0xA0 -> 0xA3 */
-  op_ldy_zp,   op_lda_zp,   op_ldx_zp,   op_lax_zp,   /* 0xA4 -> 0xA7 */
-  op_tay,      op_lda_imm,  op_tax,      op_lxa_imm,  /* 0xA8 -> 0xAB */
-  op_ldy_abs,  op_lda_abs,  op_ldx_abs,  op_lax_abs,  /* 0xAC -> 0xAF */
-  op_bcs,      op_lda_zpyi, op_none,     op_lax_zpyi, /* 0xB0 -> 0xB3 */
-  op_ldy_zpx,  op_lda_zpx,  op_ldx_zpy,  op_lax_zpy,  /* 0xB4 -> 0xB7 */
-  op_clv,      op_lda_absy, op_tsx,      op_las_absy, /* 0xB8 -> 0xBB */
-  op_ldy_absx, op_lda_absx, op_ldx_absy, op_lax_absy, /* 0xBC -> 0xBF */
-  op_cpy_imm,  op_cmp_zpix, op_nop_imm,  op_dcp_zpix, /* 0xC0 -> 0xC3 */
-  op_cpy_zp,   op_cmp_zp,   op_dec_zp,   op_dcp_zp,   /* 0xC4 -> 0xC7 */
-  op_iny,      op_cmp_imm,  op_dex,      op_sbx_imm,  /* 0xC8 -> 0xCB */
-  op_cpy_abs,  op_cmp_abs,  op_dec_abs,  op_dcp_abs,  /* 0xCC -> 0xCF */
-  op_bne,      op_cmp_zpyi, op_none,     op_dcp_zpyi, /* 0xD0 -> 0xD3 */
-  op_nop_zpx,  op_cmp_zpx,  op_dec_zpx,  op_dcp_zpx,  /* 0xD4 -> 0xD7 */
-  op_cld,      op_cmp_absy, op_nop,      op_dcp_absy, /* 0xD8 -> 0xDB */
-  op_nop_absx, op_cmp_absx, op_dec_absx, op_dcp_absx, /* 0xDC -> 0xDF */
-  op_cpx_imm,  op_sbc_zpix, op_nop_imm,  op_isc_zpix, /* 0xE0 -> 0xE3 */
-  op_cpx_zp,   op_sbc_zp,   op_inc_zp,   op_isc_zp,   /* 0xE4 -> 0xE7 */
-  op_inx,      op_sbc_imm,  op_nop,      op_usbc_imm, /* 0xE8 -> 0xEB */
-  op_cpx_abs,  op_sbc_abs,  op_inc_abs,  op_isc_abs,  /* 0xEC -> 0xEF */
-  op_beq,      op_sbc_zpyi, op_none,     op_isc_zpyi, /* 0xF0 -> 0xF3 */
-  op_nop_zpx,  op_sbc_zpx,  op_inc_zpx,  op_isc_zpx,  /* 0xF4 -> 0xF7 */
-  op_sed,      op_sbc_absy, op_nop,      op_isc_absy, /* 0xF8 -> 0xFB */
-  op_nop_absx, op_sbc_absx, op_inc_absx, op_isc_absx, /* 0xFC -> 0xFF */
+  MOS6510_OPCODES
 };
+#undef OPCODE
 
+#define OPCODE(code, name, length, base_cycles) base_cycles,
+static const uint8_t opcode_cycles[UINT8_MAX + 1] = {
+  MOS6510_OPCODES
+};
+#undef OPCODE
 
+#define OPCODE(code, name, length, base_cycles) length,
+static const uint8_t opcode_length[UINT8_MAX + 1] = {
+  MOS6510_OPCODES
+};
+#undef OPCODE
 
-/* Base cycles when page boundary crossing is not considered. */
-static uint8_t opcode_cycles[UINT8_MAX + 1] = {
-/* -0 -1 -2 -3 -4 -5 -6 -7 -8 -9 -A -B -C -D -E -F */
-    7, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, /* 0x0- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0x1- */
-    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, /* 0x2- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0x3- */
-    6, 6, 0, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, /* 0x4- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0x5- */
-    6, 6, 0, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, /* 0x6- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0x7- */
-    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, /* 0x8- */
-    2, 6, 0, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, /* 0x9- */
-    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, /* 0xA- */
-    2, 5, 0, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, /* 0xB- */
-    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, /* 0xC- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0xD- */
-    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, /* 0xE- */
-    2, 5, 0, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, /* 0xF- */
+#define OPCODE(code, name, length, base_cycles) #name,
+static const char *opcode_handler[UINT8_MAX + 1] = {
+  MOS6510_OPCODES
 };
+#undef OPCODE
+
+
+
+/* Operand bytes following the opcode, with PC moved past them. */
+#ifdef __GNUC__
+__attribute__((always_inline))
+#endif
+static inline uint16_t mos6510_operand(mos6510_t *cpu, mem_t *mem,
+  uint8_t length)
+{
+  uint16_t operand = 0;
+
+  if (length > 1) {
+    operand = mos6510_read(mem, cpu->pc++);
+  }
+  if (length > 2) {
+    operand += mos6510_read(mem, cpu->pc++) * 256;
+  }
+  return operand;
+}
 
 
 
 void mos6510_execute(mos6510_t *cpu, mem_t *mem)
 {
   uint8_t opcode;
-  opcode = mem_read(mem, cpu->pc++);
+  uint16_t operand;
+  if (mos6510_trap_armed(cpu->pc) && mos6510_trap_execute(cpu, mem)) {
+    return;
+  }
+  if (mos6510_trace_enabled) {
+    mos6510_trace_add(cpu);
+  }
+  opcode = mos6510_read(mem, cpu->pc++);
+  operand = mos6510_operand(cpu, mem, opcode_length[opcode]);
   cpu->cycles += opcode_cycles[opcode];
-  (opcode_function[opcode])(cpu, mem);
+  (opcode_function[opcode])(cpu, mem, operand);
   debugger_mem_execute(cpu->pc);
 }
 
 
 
+/* Name of the handler for an opcode, for generating code calling it. */
+const char *mos6510_opcode_handler(uint8_t opcode)
+{
+  return opcode_handler[opcode];
+}
+
+
+
+#ifdef __GNUC__
+#define MOS6510_BLOCK_CACHE_SIZE 4096 /* Direct mapped on the address. */
+#define MOS6510_BLOCK_MAX 32 /* Instructions */
+
+/* Instruction pairs executed by one fused handler when found next to each
+   other in a block. Chosen from a "tp" dump, the (zp),Y pair moves screen
+   lines and memory blocks in the KERNAL and BASIC ROMs, and the others
+   close their loops. The first instruction of each pair can not write
+   memory or change PC, and adds at most one cycle for a page crossing.
+   FUSED(first opcode, first handler, second opcode, second handler) */
+#define MOS6510_FUSED \
+  FUSED(0xB1, lda_zpyi, 0x91, sta_zpyi) \
+  FUSED(0x88, dey,      0x10, bpl) \
+  FUSED(0x88, dey,      0xD0, bne) \
+  FUSED(0xCA, dex,      0xD0, bne)
+
+#define FUSED(first_code, first, second_code, second) \
+  MOS6510_FUSED_##first##_##second,
+typedef enum {
+  MOS6510_FUSED
+  MOS6510_FUSED_MAX,
+} mos6510_fused_t;
+#undef FUSED
+
+/* Called with PC already after the second instruction, which the first
+   does not look at. Both handlers are inlined into one body. Cycles
+   beyond the base cycles of both are left in cpu->cycles. */
+#define FUSED(first_code, first, second_code, second) \
+__attribute__((flatten)) \
+static void mos6510_fused_##first##_##second(mos6510_t *cpu, mem_t *mem, \
+  uint16_t first_operand, uint16_t second_operand) \
+{ \
+  op_##first(cpu, mem, first_operand); \
+  op_##second(cpu, mem, second_operand); \
+}
+MOS6510_FUSED
+#undef FUSED
+
+typedef void (*mos6510_jit_func_t)(mos6510_t *, mem_t *,
+  uint64_t *, const uint64_t *);
+
+typedef struct mos6510_block_s {
+  uint8_t *page;       /* Page the block was decoded from. */
+  uint32_t generation; /* Code generation of that page at the time. */
+  uint16_t pc;
+  uint8_t count;
+  uint8_t opcode[MOS6510_BLOCK_MAX];
+  uint16_t handler[MOS6510_BLOCK_MAX]; /* Opcode, or above for fused. */
+  uint8_t idle; /* Passes left to prove it an idle loop, 0 if it is not. */
+  uint8_t hot;  /* Runs so far, translated when reaching MOS6510_JIT_HOT. */
+  mos6510_jit_func_t jit; /* Host code for this decode of the block. */
+} mos6510_block_t;
+
+static mos6510_block_t mos6510_block_cache[MOS6510_BLOCK_CACHE_SIZE];
+
+#define MOS6510_LOCKSTEP_SLICE 1000 /* Cycles */
+
+static uint8_t mos6510_lockstep_ram[UINT16_MAX + 1];
+static uint8_t mos6510_lockstep_fast[UINT16_MAX + 1];
+
+
+
+static inline bool mos6510_block_end(uint8_t opcode)
+{
+  switch (opcode) {
+  case 0x00: /* BRK */
+  case 0x20: /* JSR */
+  case 0x40: /* RTI */
+  case 0x60: /* RTS */
+  case 0x4C: /* JMP */
+  case 0x6C: /* JMP */
+  case 0x10: /* BPL */
+  case 0x30: /* BMI */
+  case 0x50: /* BVC */
+  case 0x70: /* BVS */
+  case 0x90: /* BCC */
+  case 0xB0: /* BCS */
+  case 0xD0: /* BNE */
+  case 0xF0: /* BEQ */
+    return true;
+  default:
+    return opcode_cycles[opcode] == 0; /* Unhandled, may be trapped. */
+  }
+}
+
+
+
+static inline uint16_t mos6510_block_fuse(uint8_t first, uint8_t second)
+{
+#define FUSED(first_code, first_name, second_code, second_name) \
+  if (first == first_code && second == second_code) { \
+    return UINT8_MAX + 1 + MOS6510_FUSED_##first_name##_##second_name; \
+  }
+  MOS6510_FUSED
+#undef FUSED
+  return first;
+}
+
+
+
+typedef enum {
+  MOS6510_IDLE_NONE,  /* Not allowed in an idle loop. */
+  MOS6510_IDLE_OTHER, /* No memory operand. */
+  MOS6510_IDLE_READ,
+  MOS6510_IDLE_WRITE,
+} mos6510_idle_access_t;
+
+/* Instructions that do not change state on their own, so a loop made only
+   of these can not leave until an interrupt. Stores are included, once
+   the registers repeat they just write the same value again. */
+static inline mos6510_idle_access_t mos6510_idle_access(uint8_t opcode)
+{
+  switch (opcode) {
+  case 0xA5: case 0xAD: /* LDA */
+  case 0xA6: case 0xAE: /* LDX */
+  case 0xA4: case 0xAC: /* LDY */
+  case 0xC5: case 0xCD: /* CMP */
+  case 0xE4: case 0xEC: /* CPX */
+  case 0xC4: case 0xCC: /* CPY */
+  case 0x25: case 0x2D: /* AND */
+  case 0x05: case 0x0D: /* ORA */
+  case 0x45: case 0x4D: /* EOR */
+  case 0x24: case 0x2C: /* BIT */
+    return MOS6510_IDLE_READ;
+
+  case 0x85: case 0x8D: /* STA */
+  case 0x86: case 0x8E: /* STX */
+  case 0x84: case 0x8C: /* STY */
+    return MOS6510_IDLE_WRITE;
+
+  case 0xA9: case 0xA2: case 0xA0: case 0xC9: case 0xE0: case 0xC0:
+  case 0x29: case 0x09: case 0x49: /* Immediate */
+  case 0xAA: case 0xA8: case 0x8A: case 0x98: case 0xBA: /* Transfers */
+  case 0x18: case 0x38: case 0xB8: case 0xD8: case 0xF8: /* Flags */
+  case 0xEA: /* NOP */
+  case 0x10: case 0x30: case 0x50: case 0x70:
+  case 0x90: case 0xB0: case 0xD0: case 0xF0: /* Branches */
+  case 0x4C: /* JMP */
+    return MOS6510_IDLE_OTHER;
+
+  default:
+    return MOS6510_IDLE_NONE;
+  }
+}
+
+
+
+/* Check for a loop like "JMP *" or "LDA $02 : BEQ *-2", with the last
+   instruction going back to the start of the block. */
+static bool mos6510_block_idle(mos6510_block_t *block, const uint8_t *page)
+{
+  int offset;
+  int last;
+  int i;
+  uint16_t target;
+
+  offset = block->pc & 0xFF;
+  last = offset;
+  for (i = 0; i < block->count; i++) {
+    if (mos6510_idle_access(block->opcode[i]) == MOS6510_IDLE_NONE) {
+      return false;
+    }
+    last = offset;
+    offset += opcode_length[block->opcode[i]];
+  }
+
+  if (block->opcode[block->count - 1] == 0x4C) {
+    target = page[last + 1] + (page[last + 2] * 256);
+  } else if (opcode_length[block->opcode[block->count - 1]] == 2 &&
+    mos6510_block_end(block->opcode[block->count - 1])) {
+    target = (block->pc & 0xFF00) + offset + (int8_t)page[last + 1];
+  } else {
+    return false;
+  }
+  return target == block->pc;
+}
+
+
+
+static mos6510_block_t *mos6510_block_get(mem_t *mem, uint16_t pc)
+{
+  mos6510_block_t *block;
+  uint8_t *page;
+  uint8_t opcode;
+  int offset;
+  int i;
+
+  /* Zero page and stack are written all the time, and I/O is never code
+     worth caching. */
+  page = mem->read_page[pc >> 8];
+  if (page == NULL || pc < 0x200) {
+    return NULL;
+  }
+
+  block = &mos6510_block_cache[pc % MOS6510_BLOCK_CACHE_SIZE];
+  if (block->count > 0 && block->pc == pc && block->page == page &&
+    block->generation == mem->code_generation[pc >> 8]) {
+    return block;
+  }
+
+  /* Decode a straight-line block, ending on the first control transfer or
+     before an instruction that would cross into the next page. */
+  block->page = page;
+  block->generation = mem->code_generation[pc >> 8];
+  block->pc = pc;
+  block->count = 0;
+  block->hot = 0;
+  block->jit = NULL;
+  offset = pc & 0xFF;
+  while (block->count < MOS6510_BLOCK_MAX) {
+    opcode = page[offset];
+    if (offset + opcode_length[opcode] > 0x100) {
+      break;
+    }
+    if (block->count > 0 && mos6510_trap_armed((pc & 0xFF00) + offset)) {
+      break; /* Let the trap be checked at the next fetch. */
+    }
+    block->opcode[block->count++] = opcode;
+    if (mos6510_block_end(opcode)) {
+      break;
+    }
+    offset += opcode_length[opcode];
+  }
+
+  if (block->count == 0) {
+    return NULL;
+  }
+  for (i = 0; i < block->count; i++) {
+    if (i + 1 < block->count) {
+      block->handler[i] = mos6510_block_fuse(block->opcode[i],
+        block->opcode[i + 1]);
+    } else {
+      block->handler[i] = block->opcode[i];
+    }
+  }
+  block->idle = mos6510_block_idle(block, page) ? 2 : 0;
+  mem_code_mark(mem, pc);
+  return block;
+}
+
+
+
+static inline uint64_t mos6510_idle_state(mos6510_t *cpu)
+{
+  return cpu->a | (cpu->x << 8) | (cpu->y << 16) | (cpu->sp << 24) |
+    ((uint64_t)cpu->n_result << 32) | ((uint64_t)cpu->z_result << 40) |
+    ((uint64_t)cpu->sr.c << 48) | ((uint64_t)cpu->sr.v << 49) |
+    ((uint64_t)cpu->sr.d << 50) | ((uint64_t)cpu->sr.i << 51);
+}
+
+
+
+/* Memory accessed by the loop must be plain RAM or ROM. I/O changes by
+   itself or has side effects, and so does the processor port. */
+static bool mos6510_idle_ram(mos6510_block_t *block, mem_t *mem)
+{
+  uint16_t address;
+  uint16_t operand;
+  uint8_t opcode;
+  int i;
+
+  address = block->pc;
+  for (i = 0; i < block->count; i++) {
+    opcode = block->opcode[i];
+    operand = block->page[(address + 1) & 0xFF];
+    if (opcode_length[opcode] == 3) {
+      operand += block->page[(address + 2) & 0xFF] * 256;
+    }
+    switch (mos6510_idle_access(opcode)) {
+    case MOS6510_IDLE_READ:
+      if (mem->read_page[operand >> 8] == NULL) {
+        return false;
+      }
+      break;
+
+    case MOS6510_IDLE_WRITE:
+      if (mem->write_page[operand >> 8] == NULL || operand <= 0x0001) {
+        return false;
+      }
+      break;
+
+    default:
+      break;
+    }
+    address += opcode_length[opcode];
+  }
+  return true;
+}
+
+
+
+/* Current contents of everything the loop stores to, in block order. */
+static void mos6510_idle_stored(mos6510_block_t *block, mem_t *mem,
+  uint8_t stored[MOS6510_BLOCK_MAX])
+{
+  uint16_t address;
+  uint16_t operand;
+  uint8_t opcode;
+  int i;
+
+  address = block->pc;
+  for (i = 0; i < block->count; i++) {
+    opcode = block->opcode[i];
+    stored[i] = 0;
+    if (mos6510_idle_access(opcode) == MOS6510_IDLE_WRITE) {
+      operand = block->page[(address + 1) & 0xFF];
+      if (opcode_length[opcode] == 3) {
+        operand += block->page[(address + 2) & 0xFF] * 256;
+      }
+      stored[i] = mem->write_page[operand >> 8][operand & 0xFF];
+    }
+    address += opcode_length[opcode];
+  }
+}
+
+
+
+/* Run one pass of an idle loop candidate. If it ends where it started in
+   the same state and without changing memory, every following pass until
+   the cycle budget runs out would be the same, so those are skipped in
+   one go. The last partial pass is left to the caller to keep the
+   interrupt point exact. Returns true when the budget ran out during the
+   pass. */
+static bool mos6510_idle(mos6510_t *cpu, mem_t *mem, mos6510_block_t *block,
+  uint64_t *cycle, const uint64_t *until)
+{
+  uint64_t state;
+  uint64_t start;
+  uint64_t pass;
+  uint8_t stored[MOS6510_BLOCK_MAX];
+  uint8_t stored_after[MOS6510_BLOCK_MAX];
+  uint8_t opcode;
+  int i;
+
+  state = mos6510_idle_state(cpu);
+  mos6510_idle_stored(block, mem, stored);
+  start = *cycle;
+  for (i = 0; i < block->count; i++) {
+    opcode = block->opcode[i];
+    cpu->pc++;
+    cpu->cycles += opcode_cycles[opcode];
+    (opcode_function[opcode])(cpu, mem,
+      mos6510_operand(cpu, mem, opcode_length[opcode]));
+    *cycle += cpu->cycles;
+    cpu->cycles = 0;
+    if (*cycle >= *until || debugger_break) {
+      return true;
+    }
+    if (i < block->count - 1 && mem->code_generation[block->pc >> 8] !=
+      block->generation) {
+      return false;
+    }
+  }
+
+  if (cpu->pc != block->pc) {
+    return false; /* Left the loop. */
+  }
+  mos6510_idle_stored(block, mem, stored_after);
+  if (mos6510_idle_state(cpu) != state ||
+    memcmp(stored, stored_after, block->count) != 0) {
+    block->idle--; /* Expected once on entry, but not in every pass. */
+    return false;
+  }
+  block->idle = 2;
+
+  if (*until == UINT64_MAX) {
+    return false; /* Nothing to wait for. */
+  }
+  pass = *cycle - start;
+  *cycle += ((*until - *cycle - 1) / pass) * pass;
+  return false;
+}
+
+
+
+#ifdef MOS6510_JIT
+#define MOS6510_JIT_SIZE (4 * 1024 * 1024) /* Bytes of host code. */
+#define MOS6510_JIT_BLOCK_SIZE 4096 /* More than any block translates to. */
+#define MOS6510_JIT_HOT 32 /* Runs of a block before it is translated. */
+
+static uint8_t *mos6510_jit_code = NULL;
+static size_t mos6510_jit_used = 0;
+static bool mos6510_jit_failed = false;
+
+typedef struct mos6510_jit_emit_s {
+  uint8_t *code;
+  int size;
+  int exit[MOS6510_BLOCK_MAX * 3]; /* Jumps to patch with the epilogue. */
+  int exits;
+} mos6510_jit_emit_t;
+
+/* Registers in the translated code, all callee saved: rbx = cpu,
+   rbp = mem, r13 = cycle, r14 = until and r15 = &debugger_break. */
+#define MOS6510_JIT_CPU(field) ((uint8_t)offsetof(mos6510_t, field))
+#define MOS6510_JIT_RAM(address) \
+  ((uint32_t)(offsetof(mem_t, ram) + (address)))
+
+
+
+static void mos6510_jit_emit(mos6510_jit_emit_t *e, int count, ...)
+{
+  va_list args;
+
+  va_start(args, count);
+  while (count-- > 0) {
+    e->code[e->size++] = va_arg(args, int);
+  }
+  va_end(args);
+}
+
+
+
+static void mos6510_jit_emit_value(mos6510_jit_emit_t *e, uint64_t value,
+  int bytes)
+{
+  while (bytes-- > 0) {
+    e->code[e->size++] = value & 0xFF;
+    value >>= 8;
+  }
+}
+
+
+
+/* Conditional jump to the epilogue, the offset is filled in at the end. */
+static void mos6510_jit_exit(mos6510_jit_emit_t *e, uint8_t condition)
+{
+  mos6510_jit_emit(e, 2, 0x0F, condition);
+  e->exit[e->exits++] = e->size;
+  mos6510_jit_emit_value(e, 0, 4);
+}
+
+
+
+/* mov word [rbx+pc], value */
+static void mos6510_jit_pc(mos6510_jit_emit_t *e, uint16_t value)
+{
+  mos6510_jit_emit(e, 3, 0x66, 0xC7, 0x43);
+  mos6510_jit_emit(e, 1, MOS6510_JIT_CPU(pc));
+  mos6510_jit_emit_value(e, value, 2);
+}
+
+
+
+/* add qword [r13], cycles */
+static void mos6510_jit_cycles(mos6510_jit_emit_t *e, uint8_t cycles)
+{
+  mos6510_jit_emit(e, 5, 0x49, 0x83, 0x45, 0x00, cycles);
+}
+
+
+
+/* Value in al to a register, also giving the N and Z flags. */
+static void mos6510_jit_result(mos6510_jit_emit_t *e, uint8_t field)
+{
+  mos6510_jit_emit(e, 3, 0x88, 0x43, field);
+  mos6510_jit_emit(e, 3, 0x88, 0x43, MOS6510_JIT_CPU(n_result));
+  mos6510_jit_emit(e, 3, 0x88, 0x43, MOS6510_JIT_CPU(z_result));
+}
+
+
+
+/* Plain RAM store, same as mem_write() for pages that never change
+   mapping, including invalidating any code decoded from the page. */
+static void mos6510_jit_store(mos6510_jit_emit_t *e, uint8_t field,
+  uint16_t address)
+{
+  uint32_t map;
+
+  map = offsetof(mem_t, code_map) + (address >> 11);
+  mos6510_jit_emit(e, 3, 0x0F, 0xB6, 0x43); /* movzx eax, byte [rbx+r] */
+  mos6510_jit_emit(e, 1, field);
+  mos6510_jit_emit(e, 2, 0x88, 0x85); /* mov [rbp+ram], al */
+  mos6510_jit_emit_value(e, MOS6510_JIT_RAM(address), 4);
+  mos6510_jit_emit(e, 2, 0xF6, 0x85); /* test byte [rbp+map], bit */
+  mos6510_jit_emit_value(e, map, 4);
+  mos6510_jit_emit(e, 1, 1 << ((address >> 8) & 0x7));
+  mos6510_jit_emit(e, 2, 0x74, 13); /* jz over the next two */
+  mos6510_jit_emit(e, 2, 0x80, 0xA5); /* and byte [rbp+map], ~bit */
+  mos6510_jit_emit_value(e, map, 4);
+  mos6510_jit_emit(e, 1, ~(1 << ((address >> 8) & 0x7)) & 0xFF);
+  mos6510_jit_emit(e, 2, 0xFF, 0x85); /* inc dword [rbp+generation] */
+  mos6510_jit_emit_value(e, offsetof(mem_t, code_generation) +
+    (address >> 8) * sizeof(uint32_t), 4);
+}
+
+
+
+/* Conditional branch ending a block, the extra cycles for taking it and
+   for crossing a page are known in advance. */
+static void mos6510_jit_branch(mos6510_jit_emit_t *e, uint8_t opcode,
+  uint16_t next, uint16_t operand)
+{
+  uint16_t target;
+
+  target = next + (int8_t)operand;
+  if (opcode == 0xD0 || opcode == 0xF0) { /* BNE, BEQ */
+    mos6510_jit_emit(e, 4, 0x80, 0x7B, MOS6510_JIT_CPU(z_result), 0x00);
+    mos6510_jit_emit(e, 2, (opcode == 0xD0) ? 0x74 : 0x75, 11);
+  } else { /* BPL, BMI */
+    mos6510_jit_emit(e, 4, 0xF6, 0x43, MOS6510_JIT_CPU(n_result), 0x80);
+    mos6510_jit_emit(e, 2, (opcode == 0x10) ? 0x75 : 0x74, 11);
+  }
+  mos6510_jit_pc(e, target);
+  mos6510_jit_cycles(e, ((next & 0xFF00) != (target & 0xFF00)) ? 2 : 1);
+  mos6510_jit_cycles(e, opcode_cycles[opcode]);
+}
+
+
+
+/* Simple instructions on the registers, plain RAM and the lazily kept
+   N and Z flags are done in host code. Everything else, and any access
+   that could reach I/O or the processor port, calls the opcode handler.
+   Returns false when nothing was emitted. */
+static bool mos6510_jit_inline(mos6510_jit_emit_t *e, uint8_t opcode,
+  uint16_t next, uint16_t operand)
+{
+  uint8_t field;
+
+  switch (opcode) {
+  case 0xA9: case 0xA2: case 0xA0: /* LDA, LDX, LDY immediate */
+    field = (opcode == 0xA9) ? MOS6510_JIT_CPU(a) :
+      (opcode == 0xA2) ? MOS6510_JIT_CPU(x) : MOS6510_JIT_CPU(y);
+    mos6510_jit_emit(e, 2, 0xB0, operand); /* mov al, operand */
+    mos6510_jit_result(e, field);
+    break;
+
+  case 0xA5: case 0xA6: case 0xA4: /* LDA, LDX, LDY zero page */
+  case 0xAD: case 0xAE: case 0xAC: /* LDA, LDX, LDY absolute */
+    if (operand >= 0xA000) {
+      return false; /* ROM, RAM or I/O depending on the banking. */
+    }
+    field = (opcode & 0x03) == 0x01 ? MOS6510_JIT_CPU(a) :
+      (opcode & 0x03) == 0x02 ? MOS6510_JIT_CPU(x) : MOS6510_JIT_CPU(y);
+    mos6510_jit_emit(e, 3, 0x0F, 0xB6, 0x85); /* movzx eax, [rbp+ram] */
+    mos6510_jit_emit_value(e, MOS6510_JIT_RAM(operand), 4);
+    mos6510_jit_result(e, field);
+    break;
+
+  case 0x85: case 0x86: case 0x84: /* STA, STX, STY zero page */
+  case 0x8D: case 0x8E: case 0x8C: /* STA, STX, STY absolute */
+    if (operand <= 0x0001 || operand >= 0xA000) {
+      return false; /* Processor port or banked. */
+    }
+    field = (opcode & 0x03) == 0x01 ? MOS6510_JIT_CPU(a) :
+      (opcode & 0x03) == 0x02 ? MOS6510_JIT_CPU(x) : MOS6510_JIT_CPU(y);
+    mos6510_jit_store(e, field, operand);
+    break;
+
+  case 0xAA: case 0xA8: case 0x8A: case 0x98: /* TAX, TAY, TXA, TYA */
+    mos6510_jit_emit(e, 4, 0x0F, 0xB6, 0x43, (opcode == 0xAA ||
+      opcode == 0xA8) ? MOS6510_JIT_CPU(a) : (opcode == 0x8A) ?
+      MOS6510_JIT_CPU(x) : MOS6510_JIT_CPU(y));
+    mos6510_jit_result(e, (opcode == 0xAA) ? MOS6510_JIT_CPU(x) :
+      (opcode == 0xA8) ? MOS6510_JIT_CPU(y) : MOS6510_JIT_CPU(a));
+    break;
+
+  case 0xE8: case 0xCA: case 0xC8: case 0x88: /* INX, DEX, INY, DEY */
+    field = (opcode == 0xE8 || opcode == 0xCA) ?
+      MOS6510_JIT_CPU(x) : MOS6510_JIT_CPU(y);
+    mos6510_jit_emit(e, 4, 0x0F, 0xB6, 0x43, field);
+    mos6510_jit_emit(e, 2, 0xFE, /* inc al, dec al */
+      (opcode == 0xE8 || opcode == 0xC8) ? 0xC0 : 0xC8);
+    mos6510_jit_result(e, field);
+    break;
+
+  case 0xEA: /* NOP */
+    break;
+
+  case 0x4C: /* JMP */
+    mos6510_jit_pc(e, operand);
+    break;
+
+  case 0xD0: case 0xF0: case 0x10: case 0x30: /* BNE, BEQ, BPL, BMI */
+    mos6510_jit_branch(e, opcode, next, operand);
+    return true;
+
+  default:
+    return false;
+  }
+
+  mos6510_jit_cycles(e, opcode_cycles[opcode]);
+  return true;
+}
+
+
+
+/* Call the opcode handler the same way the threaded core does, and add
+   its cycles. */
+static void mos6510_jit_call(mos6510_jit_emit_t *e, uint8_t opcode,
+  uint16_t operand)
+{
+  mos6510_jit_emit(e, 3, 0x48, 0x89, 0xDF); /* mov rdi, rbx */
+  mos6510_jit_emit(e, 3, 0x48, 0x89, 0xEE); /* mov rsi, rbp */
+  mos6510_jit_emit(e, 1, 0xBA); /* mov edx, operand */
+  mos6510_jit_emit_value(e, operand, 4);
+  mos6510_jit_emit(e, 2, 0x48, 0xB8); /* mov rax, handler */
+  mos6510_jit_emit_value(e, (uintptr_t)opcode_function[opcode], 8);
+  mos6510_jit_emit(e, 2, 0xFF, 0xD0); /* call rax */
+  mos6510_jit_emit(e, 4, 0x0F, 0xB6, 0x43, MOS6510_JIT_CPU(cycles));
+  mos6510_jit_emit(e, 3, 0x83, 0xC0, opcode_cycles[opcode]); /* add eax */
+  mos6510_jit_emit(e, 4, 0x49, 0x01, 0x45, 0x00); /* add [r13], rax */
+  mos6510_jit_emit(e, 4, 0xC6, 0x43, MOS6510_JIT_CPU(cycles), 0x00);
+}
+
+
+
+#define FUSED(first_code, first, second_code, second) \
+  mos6510_fused_##first##_##second,
+static void (*const mos6510_jit_fused_function[MOS6510_FUSED_MAX])
+  (mos6510_t *, mem_t *, uint16_t, uint16_t) = {
+  MOS6510_FUSED
+};
+#undef FUSED
+
+
+
+static bool mos6510_jit_inlines(uint8_t opcode, uint16_t next,
+  uint16_t operand)
+{
+  uint8_t scratch[64];
+  mos6510_jit_emit_t e;
+
+  e.code = scratch;
+  e.size = 0;
+  e.exits = 0;
+  return mos6510_jit_inline(&e, opcode, next, operand);
+}
+
+
+
+/* A fused pair runs as one handler call when the cycle budget can not run
+   out after its first half, see the threaded core. Otherwise it goes to
+   the code for the single instructions that follows. Returns the offset
+   of the jump over those, to be filled in after the second one. */
+static int mos6510_jit_fused(mos6510_jit_emit_t *e, uint16_t handler,
+  uint8_t first, uint8_t second, uint16_t operand, uint16_t second_operand,
+  uint16_t after)
+{
+  int single;
+  int over;
+
+  mos6510_jit_emit(e, 4, 0x49, 0x8B, 0x45, 0x00); /* mov rax, [r13] */
+  mos6510_jit_emit(e, 4, 0x48, 0x83, 0xC0, opcode_cycles[first] + 1);
+  mos6510_jit_emit(e, 3, 0x49, 0x3B, 0x06); /* cmp rax, [r14] */
+  mos6510_jit_emit(e, 2, 0x0F, 0x83); /* jae single */
+  single = e->size;
+  mos6510_jit_emit_value(e, 0, 4);
+
+  mos6510_jit_pc(e, after);
+  mos6510_jit_emit(e, 3, 0x48, 0x89, 0xDF); /* mov rdi, rbx */
+  mos6510_jit_emit(e, 3, 0x48, 0x89, 0xEE); /* mov rsi, rbp */
+  mos6510_jit_emit(e, 1, 0xBA); /* mov edx, operand */
+  mos6510_jit_emit_value(e, operand, 4);
+  mos6510_jit_emit(e, 1, 0xB9); /* mov ecx, second operand */
+  mos6510_jit_emit_value(e, second_operand, 4);
+  mos6510_jit_emit(e, 2, 0x48, 0xB8); /* mov rax, handler */
+  mos6510_jit_emit_value(e,
+    (uintptr_t)mos6510_jit_fused_function[handler - UINT8_MAX - 1], 8);
+  mos6510_jit_emit(e, 2, 0xFF, 0xD0); /* call rax */
+  mos6510_jit_emit(e, 4, 0x0F, 0xB6, 0x43, MOS6510_JIT_CPU(cycles));
+  mos6510_jit_emit(e, 3, 0x83, 0xC0, /* add eax */
+    opcode_cycles[first] + opcode_cycles[second]);
+  mos6510_jit_emit(e, 4, 0x49, 0x01, 0x45, 0x00); /* add [r13], rax */
+  mos6510_jit_emit(e, 4, 0xC6, 0x43, MOS6510_JIT_CPU(cycles), 0x00);
+  mos6510_jit_emit(e, 1, 0xE9); /* jmp over */
+  over = e->size;
+  mos6510_jit_emit_value(e, 0, 4);
+
+  *(int32_t *)&e->code[single] = e->size - (single + 4);
+  return over;
+}
+
+
+
+static uint16_t mos6510_jit_operand(mos6510_block_t *block,
+  uint16_t address)
+{
+  uint16_t operand = 0;
+  uint8_t opcode;
+
+  opcode = block->page[address & 0xFF];
+  if (opcode_length[opcode] > 1) {
+    operand = block->page[(address + 1) & 0xFF];
+  }
+  if (opcode_length[opcode] > 2) {
+    operand += block->page[(address + 2) & 0xFF] * 256;
+  }
+  return operand;
+}
+
+
+
+static void mos6510_jit_flush(void)
+{
+  int i;
+
+  mos6510_jit_used = 0;
+  for (i = 0; i < MOS6510_BLOCK_CACHE_SIZE; i++) {
+    mos6510_block_cache[i].jit = NULL;
+    mos6510_block_cache[i].hot = 0;
+  }
+}
+
+
+
+/* Translate a block to x86-64 code, one straight run of host code per
+   6510 instruction or fused pair. PC is stored before each instruction
+   and cycles are added after it, so state is exact whenever the code
+   leaves early: when the cycle budget is used up for an interrupt or the
+   scheduler, on a debugger break, or after a write that changed the code
+   generation of the block page. Operands are constants, the page
+   generation guards them like it guards the opcodes. I/O is only reached
+   through the opcode handlers. */
+static mos6510_jit_func_t mos6510_jit_translate(mos6510_block_t *block)
+{
+  mos6510_jit_emit_t e;
+  uint16_t address;
+  uint16_t operand;
+  uint16_t next;
+  uint16_t after;
+  uint8_t opcode;
+  bool inlined;
+  int over = -1;
+  int over_second = 0;
+  int i;
+
+  if (mos6510_jit_code == NULL) {
+    mos6510_jit_code = mmap(NULL, MOS6510_JIT_SIZE,
+      PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mos6510_jit_code == MAP_FAILED) {
+      mos6510_jit_code = NULL;
+      mos6510_jit_failed = true; /* Stay with the threaded core. */
+      return NULL;
+    }
+  }
+  if (mos6510_jit_used + MOS6510_JIT_BLOCK_SIZE > MOS6510_JIT_SIZE) {
+    mos6510_jit_flush();
+  }
+
+  e.code = &mos6510_jit_code[mos6510_jit_used];
+  e.size = 0;
+  e.exits = 0;
+  mos6510_jit_emit(&e, 2, 0x53, 0x55); /* push rbx, push rbp */
+  mos6510_jit_emit(&e, 6, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57); /* r13-15 */
+  mos6510_jit_emit(&e, 3, 0x48, 0x89, 0xFB); /* mov rbx, rdi */
+  mos6510_jit_emit(&e, 3, 0x48, 0x89, 0xF5); /* mov rbp, rsi */
+  mos6510_jit_emit(&e, 3, 0x49, 0x89, 0xD5); /* mov r13, rdx */
+  mos6510_jit_emit(&e, 3, 0x49, 0x89, 0xCE); /* mov r14, rcx */
+  mos6510_jit_emit(&e, 2, 0x49, 0xBF); /* mov r15, &debugger_break */
+  mos6510_jit_emit_value(&e, (uintptr_t)&debugger_break, 8);
+
+  address = block->pc;
+  for (i = 0; i < block->count; i++) {
+    opcode = block->opcode[i];
+    operand = mos6510_jit_operand(block, address);
+    next = address + opcode_length[opcode];
+
+    /* Pairs done inline are already one run of host code, only the ones
+       calling two handlers gain from the fused handler. */
+    if (block->handler[i] > UINT8_MAX && over < 0 &&
+      ! mos6510_jit_inlines(opcode, next, operand)) {
+      after = next + opcode_length[block->opcode[i + 1]];
+      if (! mos6510_jit_inlines(block->opcode[i + 1], after,
+        mos6510_jit_operand(block, next))) {
+        over = mos6510_jit_fused(&e, block->handler[i], opcode,
+          block->opcode[i + 1], operand, mos6510_jit_operand(block, next),
+          after);
+        over_second = i + 1;
+      }
+    }
+
+    /* The threaded core runs debugger_mem_execute() here, but blocks are
+       only used without breakpoints, so it would never break. */
+    mos6510_jit_pc(&e, next);
+    inlined = mos6510_jit_inline(&e, opcode, next, operand);
+    if (! inlined) {
+      mos6510_jit_call(&e, opcode, operand);
+    }
+    if (over >= 0 && i == over_second) {
+      *(int32_t *)&e.code[over] = e.size - (over + 4);
+      over = -1;
+    }
+
+    if (i < block->count - 1) {
+      mos6510_jit_emit(&e, 4, 0x49, 0x8B, 0x45, 0x00); /* mov rax, [r13] */
+      mos6510_jit_emit(&e, 3, 0x49, 0x3B, 0x06); /* cmp rax, [r14] */
+      mos6510_jit_exit(&e, 0x83); /* jae */
+      mos6510_jit_emit(&e, 4, 0x41, 0x80, 0x3F, 0x00); /* cmp [r15], 0 */
+      mos6510_jit_exit(&e, 0x85); /* jne */
+      if (! inlined ||
+        mos6510_idle_access(opcode) == MOS6510_IDLE_WRITE) {
+        mos6510_jit_emit(&e, 2, 0x8B, 0x85); /* mov eax, [rbp+gen] */
+        mos6510_jit_emit_value(&e, offsetof(mem_t, code_generation) +
+          (block->pc >> 8) * sizeof(uint32_t), 4);
+        mos6510_jit_emit(&e, 1, 0x3D); /* cmp eax, generation */
+        mos6510_jit_emit_value(&e, block->generation, 4);
+        mos6510_jit_exit(&e, 0x85); /* jne */
+      }
+    }
+    address = next;
+  }
+
+  for (i = 0; i < e.exits; i++) {
+    *(int32_t *)&e.code[e.exit[i]] = e.size - (e.exit[i] + 4);
+  }
+  mos6510_jit_emit(&e, 6, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D); /* r15-13 */
+  mos6510_jit_emit(&e, 3, 0x5D, 0x5B, 0xC3); /* pop rbp, pop rbx, ret */
+
+  mos6510_jit_used += (e.size + 15) & ~15;
+  return (mos6510_jit_func_t)e.code;
+}
+#endif /* MOS6510_JIT */
+
+
+
+static void mos6510_run_interpreter(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+  do {
+    profile_check(cpu->pc, *cycle);
+    mos6510_execute(cpu, mem);
+    *cycle += cpu->cycles;
+    cpu->cycles = 0;
+  } while (*cycle < *until && ! debugger_break);
+}
+
+
+
+static void mos6510_run_fast(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+#define OPCODE(code, name, length, base_cycles) &&opcode_##code,
+#define FUSED(first_code, first, second_code, second) \
+  &&fused_##first##_##second,
+  static void *opcode_label[UINT8_MAX + 1 + MOS6510_FUSED_MAX] = {
+    MOS6510_OPCODES
+    MOS6510_FUSED
+  };
+#undef FUSED
+#undef OPCODE
+  uint8_t opcode;
+  uint16_t operand;
+  mos6510_block_t *block;
+  const uint16_t *block_handler = NULL;
+  int block_left = 0;
+  int block_page = 0;
+  uint32_t block_generation = 0;
+
+  /* Opcodes come from the predecoded block as long as its page has not
+     been written to. Operands are always read from memory, so only the
+     opcodes themselves need to be guarded. */
+#define MOS6510_FETCH \
+  if (block_left > 0 && \
+    mem->code_generation[block_page] == block_generation) { \
+    block_left--; \
+    cpu->pc++; \
+    goto *opcode_label[*block_handler++]; \
+  } \
+  goto fetch;
+
+  /* Always execute at least one instruction, so single stepping works. */
+fetch:
+  profile_check(cpu->pc, *cycle);
+  if (mos6510_trap_armed(cpu->pc) && mos6510_trap_execute(cpu, mem)) {
+    *cycle += cpu->cycles;
+    cpu->cycles = 0;
+    if (*cycle >= *until || debugger_break) {
+      return;
+    }
+    goto fetch;
+  }
+  if (mos6510_trace_enabled) {
+    mos6510_trace_add(cpu);
+  } else if (debugger_breakpoint_count == 0) {
+    block = mos6510_block_get(mem, cpu->pc);
+    if (block != NULL && block->idle > 0 && mos6510_idle_ram(block, mem)) {
+      if (mos6510_idle(cpu, mem, block, cycle, until)) {
+        return;
+      }
+      goto fetch;
+    }
+#ifdef MOS6510_JIT
+    if (block != NULL && block->jit == NULL && ! mos6510_jit_failed &&
+      ++block->hot >= MOS6510_JIT_HOT) {
+      block->jit = mos6510_jit_translate(block);
+    }
+    if (block != NULL && block->jit != NULL) {
+      (block->jit)(cpu, mem, cycle, until);
+      if (*cycle >= *until || debugger_break) {
+        return;
+      }
+      goto fetch;
+    }
+#endif
+    if (block != NULL) {
+      block_handler = block->handler;
+      block_left = block->count - 1;
+      block_page = cpu->pc >> 8;
+      block_generation = block->generation;
+      cpu->pc++;
+      goto *opcode_label[*block_handler++];
+    }
+  }
+  opcode = mos6510_read(mem, cpu->pc++);
+  goto *opcode_label[opcode];
+
+  /* Each handler jumps straight to the next one, with a separate indirect
+     branch per opcode instead of one shared by all of them. */
+#define OPCODE(code, name, length, base_cycles) \
+opcode_##code: \
+  op_##name(cpu, mem, mos6510_operand(cpu, mem, length)); \
+  *cycle += base_cycles + cpu->cycles; \
+  cpu->cycles = 0; \
+  debugger_mem_execute(cpu->pc); \
+  if (*cycle >= *until || debugger_break) { \
+    return; \
+  } \
+  MOS6510_FETCH
+  MOS6510_OPCODES
+#undef OPCODE
+
+  /* Both halves run with one check of the cycle budget. The first half
+     alone could never end the run unless the budget runs out, so when
+     that is possible it is dispatched on its own instead, keeping cycles
+     and interrupt points exactly as if dispatched one by one. */
+#define FUSED(first_code, first, second_code, second) \
+fused_##first##_##second: \
+  if (*cycle + opcode_cycles[first_code] + 1 >= *until) { \
+    goto opcode_##first_code; \
+  } \
+  operand = mos6510_operand(cpu, mem, opcode_length[first_code]); \
+  cpu->pc++; \
+  mos6510_fused_##first##_##second(cpu, mem, operand, \
+    mos6510_operand(cpu, mem, opcode_length[second_code])); \
+  *cycle += opcode_cycles[first_code] + opcode_cycles[second_code] + \
+    cpu->cycles; \
+  cpu->cycles = 0; \
+  block_left--; \
+  block_handler++; \
+  debugger_mem_execute(cpu->pc); \
+  if (*cycle >= *until || debugger_break) { \
+    return; \
+  } \
+  MOS6510_FETCH
+  MOS6510_FUSED
+#undef FUSED
+
+#undef MOS6510_FETCH
+}
+
+
+
+static bool mos6510_lockstep_compare(mos6510_t *fast, mos6510_t *cpu,
+  uint64_t fast_cycle, uint64_t cycle, mem_t *mem)
+{
+  int i;
+
+  mos6510_status_sync(fast);
+  mos6510_status_sync(cpu);
+  if (fast->pc != cpu->pc || fast->a != cpu->a || fast->x != cpu->x ||
+    fast->y != cpu->y || fast->sp != cpu->sp ||
+    fast->sr.n != cpu->sr.n || fast->sr.v != cpu->sr.v ||
+    fast->sr.d != cpu->sr.d || fast->sr.i != cpu->sr.i ||
+    fast->sr.z != cpu->sr.z || fast->sr.c != cpu->sr.c) {
+    panic("Lockstep registers differ, fast PC=%04x A=%02x X=%02x Y=%02x "
+      "SP=%02x, interpreter PC=%04x A=%02x X=%02x Y=%02x SP=%02x\n",
+      fast->pc, fast->a, fast->x, fast->y, fast->sp,
+      cpu->pc, cpu->a, cpu->x, cpu->y, cpu->sp);
+    return false;
+  }
+  if (fast_cycle != cycle) {
+    panic("Lockstep cycles differ at %04x, fast %llu, interpreter %llu\n",
+      cpu->pc, (unsigned long long)fast_cycle, (unsigned long long)cycle);
+    return false;
+  }
+  for (i = 0; i <= UINT16_MAX; i++) {
+    if (mos6510_lockstep_fast[i] != mem->ram[i]) {
+      panic("Lockstep RAM differs at %04x, fast %02x, interpreter %02x\n",
+        i, mos6510_lockstep_fast[i], mem->ram[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+/* Run a slice with the fast core, including idle loop skipping, then run
+   it again from the same state with the interpreter and compare
+   registers, cycles and RAM. A slice that touched I/O or fired a trap
+   can not be run twice and is taken as it is, trap handlers load files,
+   feed the keyboard buffer or remove themselves. Otherwise the
+   interpreter result is kept. */
+static void mos6510_run_lockstep(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+  mos6510_t start;
+  mos6510_t fast;
+  uint64_t start_cycle;
+  uint64_t fast_cycle;
+  uint64_t slice;
+  uint32_t io_count;
+  uint32_t trap_fired;
+  int page;
+
+  do {
+    slice = *cycle + MOS6510_LOCKSTEP_SLICE;
+    if (slice > *until) {
+      slice = *until;
+    }
+    start = *cpu;
+    start_cycle = *cycle;
+    io_count = mem->io_count;
+    trap_fired = mos6510_trap_fired;
+    memcpy(mos6510_lockstep_ram, mem->ram, sizeof(mos6510_lockstep_ram));
+
+    mos6510_run_fast(cpu, mem, cycle, &slice);
+    if (mem->io_count != io_count || mos6510_trap_fired != trap_fired ||
+        debugger_break) {
+      continue;
+    }
+    fast = *cpu;
+    fast_cycle = *cycle;
+    memcpy(mos6510_lockstep_fast, mem->ram, sizeof(mos6510_lockstep_fast));
+
+    /* Back to the start, invalidating code on pages that were changed. */
+    for (page = 0; page < MEM_PAGES; page++) {
+      if (memcmp(&mem->ram[page * 0x100], &mos6510_lockstep_ram[page * 0x100],
+        0x100) != 0) {
+        mem->code_generation[page]++;
+      }
+    }
+    memcpy(mem->ram, mos6510_lockstep_ram, sizeof(mos6510_lockstep_ram));
+    mem_bank_update(mem);
+    *cpu = start;
+    *cycle = start_cycle;
+
+    do {
+      mos6510_execute(cpu, mem);
+      *cycle += cpu->cycles;
+      cpu->cycles = 0;
+    } while (*cycle < slice && ! debugger_break);
+    if (! debugger_break) {
+      mos6510_lockstep_compare(&fast, cpu, fast_cycle, *cycle, mem);
+    }
+  } while (*cycle < *until && ! debugger_break);
+}
+
+
+
+void mos6510_run(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+  if (mos6510_mode == MOS6510_MODE_INTERPRETER) {
+    mos6510_run_interpreter(cpu, mem, cycle, until);
+  } else if (mos6510_mode == MOS6510_MODE_LOCKSTEP) {
+    mos6510_run_lockstep(cpu, mem, cycle, until);
+  } else {
+    mos6510_run_fast(cpu, mem, cycle, until);
+  }
+}
+
+#else
+void mos6510_run(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+  /* Without computed goto there is only the interpreter. */
+  do {
+    profile_check(cpu->pc, *cycle);
+    mos6510_execute(cpu, mem);
+    *cycle += cpu->cycles;
+    cpu->cycles = 0;
+  } while (*cycle < *until && ! debugger_break);
+}
+#endif /* __GNUC__ */
+
+
+
+static uint16_t mos6510_alu_entry(mos6510_t *cpu)
+{
+  return cpu->a | (cpu->sr.c ? MOS6510_ALU_CARRY : 0) |
+    (cpu->sr.v ? MOS6510_ALU_OVERFLOW : 0);
+}
+
+
+
+void mos6510_init(void)
+{
+  mos6510_t cpu;
+  int i;
+
+  for (i = 0; i < MOS6510_ALU_SIZE; i++) {
+    cpu.sr.d = (i >> 17) & 0x1;
+    cpu.sr.c = (i >> 16) & 0x1;
+    cpu.a = i >> 8;
+    mos6510_logic_adc_reference(&cpu, i);
+    mos6510_alu_adc[i] = mos6510_alu_entry(&cpu);
+
+    cpu.sr.c = (i >> 16) & 0x1;
+    cpu.a = i >> 8;
+    mos6510_logic_sbc_reference(&cpu, i);
+    mos6510_alu_sbc[i] = mos6510_alu_entry(&cpu);
+  }
+}
+
+
+
+int mos6510_trap_count = 0;
+uint8_t mos6510_trap_map[(UINT16_MAX + 1) / 8];
+static mos6510_trap_handler_t mos6510_trap_handler[UINT16_MAX + 1];
+
+void mos6510_trap_set(uint16_t address, mos6510_trap_handler_t handler)
+{
+  if (mos6510_trap_handler[address] == NULL && handler != NULL) {
+    mos6510_trap_count++;
+    mos6510_trap_map[address >> 3] |= 1 << (address & 0x7);
+  } else if (mos6510_trap_handler[address] != NULL && handler == NULL) {
+    mos6510_trap_count--;
+    mos6510_trap_map[address >> 3] &= ~(1 << (address & 0x7));
+  }
+  mos6510_trap_handler[address] = handler;
+
+#ifdef __GNUC__
+  /* Blocks are decoded to stop before trapped addresses. */
+  memset(mos6510_block_cache, 0, sizeof(mos6510_block_cache));
+#endif
+}
+
+
+
+bool mos6510_trap_execute(mos6510_t *cpu, mem_t *mem)
+{
+  mos6510_trap_fired++;
+  return (mos6510_trap_handler[cpu->pc])(cpu, mem);
+}
+
+
+
+/* Leave a natively done routine as if it ended with RTS. */
+void mos6510_trap_return(mos6510_t *cpu, mem_t *mem)
+{
+  cpu->cycles += opcode_cycles[0x60];
+  op_rts(cpu, mem, 0);
+}
+
+
+
 void mos6510_reset(mos6510_t *cpu, mem_t *mem)
 {
-  cpu->pc  = mem_read(mem, MOS6510_VECTOR_RESET_LOW);
-  cpu->pc += mem_read(mem, MOS6510_VECTOR_RESET_HIGH) * 256;
+  cpu->pc  = mos6510_read(mem, MOS6510_VECTOR_RESET_LOW);
+  cpu->pc += mos6510_read(mem, MOS6510_VECTOR_RESET_HIGH) * 256;
   cpu->a = 0;
   cpu->x = 0;
   cpu->y = 0;
   cpu->sp = 0xFD;
-  cpu->sr.n = 0;
+  cpu->n_result = 0;
   cpu->sr.v = 0;
   cpu->sr.b = 0;
   cpu->sr.d = 0;
   cpu->sr.i = 1;
-  cpu->sr.z = 0;
+  cpu->z_result = 1;
   cpu->sr.c = 0;
   cpu->cycles = 0;
+  mos6510_status_sync(cpu);
 }
 
 
@@ -2509,8 +4007,8 @@ void mos6510_nmi(mos6510_t *cpu, mem_t *mem)
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, cpu->pc % 256);
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, mos6510_status_get(cpu, 0));
   cpu->sr.i = 1;
-  cpu->pc  = mem_read(mem, MOS6510_VECTOR_NMI_LOW);
-  cpu->pc += mem_read(mem, MOS6510_VECTOR_NMI_HIGH) * 256;
+  cpu->pc  = mos6510_read(mem, MOS6510_VECTOR_NMI_LOW);
+  cpu->pc += mos6510_read(mem, MOS6510_VECTOR_NMI_HIGH) * 256;
 }
 
 
@@ -2524,9 +4022,16 @@ void mos6510_irq(mos6510_t *cpu, mem_t *mem)
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, cpu->pc % 256);
   mem_write(mem, MEM_PAGE_STACK + cpu->sp--, mos6510_status_get(cpu, 0));
   cpu->sr.i = 1;
-  cpu->pc  = mem_read(mem, MOS6510_VECTOR_IRQ_LOW);
-  cpu->pc += mem_read(mem, MOS6510_VECTOR_IRQ_HIGH) * 256;
+  cpu->pc  = mos6510_read(mem, MOS6510_VECTOR_IRQ_LOW);
+  cpu->pc += mos6510_read(mem, MOS6510_VECTOR_IRQ_HIGH) * 256;
 }
 
 
 
+
+
+
+#ifdef RECOMPILED
+/* Output of "tmce64 -c FILE", calling the opcode handlers above. */
+#include RECOMPILED
+#endif
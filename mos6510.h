@@ -21,12 +21,28 @@ typedef struct mos6510_s {
   uint8_t x;           /* X Register */
   uint8_t y;           /* Y Register */
   uint8_t sp;          /* Stack Pointer */
-  mos6510_status_t sr; /* Status Register */
+  mos6510_status_t sr; /* Status Register, see mos6510_status_sync() */
+  uint8_t n_result;    /* Negative is bit 7 of this. */
+  uint8_t z_result;    /* Zero is set when this is 0. */
   uint8_t cycles;      /* Internal Cycle Counter */
 } mos6510_t;
 
 typedef bool (*mos6510_opcode_handler_t)(uint32_t, mos6510_t *, mem_t *);
 
+/* Called before the instruction at a trapped address is executed. Return
+   true after doing the routine natively, usually ending it with
+   mos6510_trap_return(), or false to let the CPU run it as normal. A
+   handler returning true must move PC somewhere else. */
+typedef bool (*mos6510_trap_handler_t)(mos6510_t *, mem_t *);
+
+typedef enum {
+  MOS6510_MODE_FAST,        /* Threaded core, hot blocks run as x86-64. */
+  MOS6510_MODE_INTERPRETER, /* Reference interpreter only. */
+  MOS6510_MODE_LOCKSTEP,    /* Fast core, checked by the interpreter. */
+} mos6510_mode_t;
+
+extern mos6510_mode_t mos6510_mode;
+
 #define MOS6510_VECTOR_NMI_LOW    0xFFFA
 #define MOS6510_VECTOR_NMI_HIGH   0xFFFB
 #define MOS6510_VECTOR_RESET_LOW  0xFFFC
@@ -35,10 +51,36 @@ typedef bool (*mos6510_opcode_handler_t)(uint32_t, mos6510_t *, mem_t *);
 #define MOS6510_VECTOR_IRQ_HIGH   0xFFFF
 
 void mos6510_execute(mos6510_t *cpu, mem_t *mem);
+const char *mos6510_opcode_handler(uint8_t opcode);
+void mos6510_run(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until);
+void mos6510_init(void);
 void mos6510_reset(mos6510_t *cpu, mem_t *mem);
 void mos6510_nmi(mos6510_t *cpu, mem_t *mem);
 void mos6510_irq(mos6510_t *cpu, mem_t *mem);
 
 void mos6510_trap_opcode(uint8_t opcode, mos6510_opcode_handler_t handler);
 
+extern int mos6510_trap_count;
+extern uint8_t mos6510_trap_map[(UINT16_MAX + 1) / 8];
+
+void mos6510_trap_set(uint16_t address, mos6510_trap_handler_t handler);
+bool mos6510_trap_execute(mos6510_t *cpu, mem_t *mem);
+void mos6510_trap_return(mos6510_t *cpu, mem_t *mem);
+
+/* One bit per address, only looked at while any trap is set. */
+static inline bool mos6510_trap_armed(uint16_t address)
+{
+  return mos6510_trap_count > 0 &&
+    (mos6510_trap_map[address >> 3] >> (address & 0x7)) & 0x1;
+}
+
+/* The N and Z flags are evaluated lazily, this brings sr.n and sr.z up to
+   date for anything outside of the CPU core that wants to look at them. */
+static inline void mos6510_status_sync(mos6510_t *cpu)
+{
+  cpu->sr.n = cpu->n_result >> 7;
+  cpu->sr.z = (cpu->z_result == 0);
+}
+
 #endif /* _MOS6510_H */
@@ -5,32 +5,19 @@
 #include <stdbool.h>
 
 #include "mos6510.h"
+#include "mos6510_trace.h"
 #include "mem.h"
 
 
 
-#define MOS6510_TRACE_BUFFER_SIZE 20
-
-typedef enum {
-  AM_ACCU, /* A      - Accumulator */
-  AM_IMPL, /* i      - Implied */
-  AM_IMM,  /* #      - Immediate */
-  AM_ABS,  /* a      - Absolute */
-  AM_ABSI, /* (a)    - Indirect Absolute */
-  AM_ABSX, /* a,x    - Absolute + X */
-  AM_ABSY, /* a,y    - Absolute + Y */
-  AM_REL,  /* r      - Relative */
-  AM_ZP,   /* zp     - Zero Page */
-  AM_ZPX,  /* zp,x   - Zero Page + X */
-  AM_ZPY,  /* zp,y   - Zero Page + Y */
-  AM_ZPYI, /* (zp),y - Zero Page Indirect Indexed */
-  AM_ZPIX, /* (zp,x) - Zero Page Indexed Indirect */
-  AM_NONE,
-} mos6510_address_mode_t;
-
+/* Only the registers are captured, opcodes are decoded when dumped. */
 typedef struct mos6510_trace_s {
-  mos6510_t cpu;
-  uint8_t mc[3];
+  uint16_t pc;
+  uint8_t a;
+  uint8_t x;
+  uint8_t y;
+  uint8_t sp;
+  mos6510_status_t sr;
 } mos6510_trace_t;
 
 
@@ -109,12 +96,51 @@ static char *opcode_mnemonic[UINT8_MAX + 1] = {
 
 
 
-static mos6510_trace_t mos6510_trace_buffer[MOS6510_TRACE_BUFFER_SIZE];
+bool mos6510_trace_enabled = false;
+
+static mos6510_trace_t *mos6510_trace_buffer = NULL;
+static int mos6510_trace_size = 0;
 static int mos6510_trace_index = 0;
+static int mos6510_trace_count = 0;
+
+
+
+mos6510_address_mode_t mos6510_opcode_address_mode(uint8_t opcode)
+{
+  return opcode_address_mode[opcode];
+}
+
+
+
+int mos6510_opcode_length(uint8_t opcode)
+{
+  switch (opcode_address_mode[opcode]) {
+  case AM_ACCU:
+  case AM_IMPL:
+  case AM_NONE:
+  default:
+    return 1;
+
+  case AM_IMM:
+  case AM_REL:
+  case AM_ZP:
+  case AM_ZPX:
+  case AM_ZPY:
+  case AM_ZPYI:
+  case AM_ZPIX:
+    return 2;
+
+  case AM_ABS:
+  case AM_ABSI:
+  case AM_ABSX:
+  case AM_ABSY:
+    return 3;
+  }
+}
 
 
 
-static void mos6510_disassemble(FILE *fh, uint16_t pc, uint8_t mc[3])
+void mos6510_disassemble(FILE *fh, uint16_t pc, uint8_t mc[3])
 {
   uint16_t address;
   int8_t relative;
@@ -215,68 +241,189 @@ static void mos6510_disassemble(FILE *fh, uint16_t pc, uint8_t mc[3])
 
 
 
-static void mos6510_register_dump(FILE *fh, mos6510_t *cpu, uint8_t mc[3])
+static void mos6510_register_dump(FILE *fh, mos6510_trace_t *trace,
+  uint8_t mc[3])
 {
-  fprintf(fh, ".C:%04x  ", cpu->pc);
-  mos6510_disassemble(fh, cpu->pc, mc);
+  fprintf(fh, ".C:%04x  ", trace->pc);
+  mos6510_disassemble(fh, trace->pc, mc);
   fprintf(fh, "   - ");
-  fprintf(fh, "A:%02X ", cpu->a);
-  fprintf(fh, "X:%02X ", cpu->x);
-  fprintf(fh, "Y:%02X ", cpu->y);
-  fprintf(fh, "SP:%02x ", cpu->sp);
-  fprintf(fh, "%c", (cpu->sr.n) ? 'N' : '.');
-  fprintf(fh, "%c", (cpu->sr.v) ? 'V' : '.');
+  fprintf(fh, "A:%02X ", trace->a);
+  fprintf(fh, "X:%02X ", trace->x);
+  fprintf(fh, "Y:%02X ", trace->y);
+  fprintf(fh, "SP:%02x ", trace->sp);
+  fprintf(fh, "%c", (trace->sr.n) ? 'N' : '.');
+  fprintf(fh, "%c", (trace->sr.v) ? 'V' : '.');
   fprintf(fh, "-");
-  fprintf(fh, "%c", (cpu->sr.b) ? 'B' : '.');
-  fprintf(fh, "%c", (cpu->sr.d) ? 'D' : '.');
-  fprintf(fh, "%c", (cpu->sr.i) ? 'I' : '.');
-  fprintf(fh, "%c", (cpu->sr.z) ? 'Z' : '.');
-  fprintf(fh, "%c", (cpu->sr.c) ? 'C' : '.');
+  fprintf(fh, "%c", (trace->sr.b) ? 'B' : '.');
+  fprintf(fh, "%c", (trace->sr.d) ? 'D' : '.');
+  fprintf(fh, "%c", (trace->sr.i) ? 'I' : '.');
+  fprintf(fh, "%c", (trace->sr.z) ? 'Z' : '.');
+  fprintf(fh, "%c", (trace->sr.c) ? 'C' : '.');
   fprintf(fh, "\n");
 }
 
 
 
-void mos6510_trace_init(void)
+int mos6510_trace_init(int size)
+{
+  mos6510_trace_t *buffer;
+
+  if (size <= 0 || size > MOS6510_TRACE_BUFFER_SIZE_MAX) {
+    return -1;
+  }
+
+  buffer = calloc(size, sizeof(mos6510_trace_t));
+  if (buffer == NULL) {
+    return -1;
+  }
+
+  free(mos6510_trace_buffer);
+  mos6510_trace_buffer = buffer;
+  mos6510_trace_size = size;
+  mos6510_trace_index = 0;
+  mos6510_trace_count = 0;
+  return 0;
+}
+
+
+
+void mos6510_trace_enable(bool enable)
 {
-  memset(mos6510_trace_buffer, 0,
-    MOS6510_TRACE_BUFFER_SIZE * sizeof(mos6510_trace_t));
+  if (enable && mos6510_trace_buffer == NULL) {
+    if (mos6510_trace_init(MOS6510_TRACE_BUFFER_SIZE_DEFAULT) != 0) {
+      return;
+    }
+  }
+  mos6510_trace_enabled = enable;
 }
 
 
 
-void mos6510_trace_dump(FILE *fh)
+void mos6510_trace_dump(FILE *fh, mem_t *mem, int count)
 {
   int i;
+  int index;
+  uint8_t mc[3];
+  mos6510_trace_t *trace;
+
+  if (count > mos6510_trace_count) {
+    count = mos6510_trace_count;
+  }
+
+  /* Oldest entry first, ending with the most recent one. */
+  index = mos6510_trace_index - count;
+  if (index < 0) {
+    index += mos6510_trace_size;
+  }
+
+  for (i = 0; i < count; i++) {
+    trace = &mos6510_trace_buffer[index];
+    mem_peek_block(mem, trace->pc, mc, 3);
+    mos6510_register_dump(fh, trace, mc);
 
-  for (i = 0; i < MOS6510_TRACE_BUFFER_SIZE; i++) {
-    mos6510_trace_index++;
-    if (mos6510_trace_index >= MOS6510_TRACE_BUFFER_SIZE) {
-      mos6510_trace_index = 0;
+    index++;
+    if (index >= mos6510_trace_size) {
+      index = 0;
     }
-    mos6510_register_dump(fh, &mos6510_trace_buffer[mos6510_trace_index].cpu,
-                               mos6510_trace_buffer[mos6510_trace_index].mc);
   }
 }
 
 
 
-void mos6510_trace_add(mos6510_t *cpu, mem_t *mem)
+static uint32_t *mos6510_trace_pair_count = NULL;
+
+static int mos6510_trace_pair_compare(const void *a, const void *b)
 {
-  uint8_t mc[3];
+  uint32_t count_a = mos6510_trace_pair_count[*(const uint16_t *)a];
+  uint32_t count_b = mos6510_trace_pair_count[*(const uint16_t *)b];
+  if (count_a == count_b) {
+    return *(const uint16_t *)a - *(const uint16_t *)b;
+  }
+  return (count_a < count_b) ? 1 : -1;
+}
+
+
+
+/* Count how often each opcode follows another in the trace, as input for
+   picking instruction pairs worth fusing. */
+void mos6510_trace_pairs(FILE *fh, mem_t *mem, int count)
+{
+  int i;
+  int index;
+  uint8_t opcode;
+  uint8_t previous = 0;
+  uint16_t *order;
+
+  mos6510_trace_pair_count = calloc(UINT16_MAX + 1, sizeof(uint32_t));
+  order = malloc((UINT16_MAX + 1) * sizeof(uint16_t));
+  if (mos6510_trace_pair_count == NULL || order == NULL) {
+    free(mos6510_trace_pair_count);
+    mos6510_trace_pair_count = NULL;
+    free(order);
+    return;
+  }
+
+  index = mos6510_trace_index - mos6510_trace_count;
+  if (index < 0) {
+    index += mos6510_trace_size;
+  }
+  for (i = 0; i < mos6510_trace_count; i++) {
+    opcode = mem_peek(mem, mos6510_trace_buffer[index].pc);
+    if (i > 0) {
+      mos6510_trace_pair_count[(previous << 8) | opcode]++;
+    }
+    previous = opcode;
+
+    index++;
+    if (index >= mos6510_trace_size) {
+      index = 0;
+    }
+  }
+
+  for (i = 0; i <= UINT16_MAX; i++) {
+    order[i] = i;
+  }
+  qsort(order, UINT16_MAX + 1, sizeof(uint16_t), mos6510_trace_pair_compare);
+
+  for (i = 0; i < count && i <= UINT16_MAX; i++) {
+    if (mos6510_trace_pair_count[order[i]] == 0) {
+      break;
+    }
+    fprintf(fh, "%10u %6.2f%%  %02X %02X  %s %s\n",
+      mos6510_trace_pair_count[order[i]],
+      (mos6510_trace_pair_count[order[i]] * 100.0) /
+        (mos6510_trace_count - 1),
+      order[i] >> 8, order[i] & 0xFF,
+      opcode_mnemonic[order[i] >> 8], opcode_mnemonic[order[i] & 0xFF]);
+  }
+
+  free(mos6510_trace_pair_count);
+  mos6510_trace_pair_count = NULL;
+  free(order);
+}
+
+
+
+void mos6510_trace_add(mos6510_t *cpu)
+{
+  mos6510_trace_t *trace;
+
+  trace = &mos6510_trace_buffer[mos6510_trace_index];
+  trace->pc = cpu->pc;
+  trace->a  = cpu->a;
+  trace->x  = cpu->x;
+  trace->y  = cpu->y;
+  trace->sp = cpu->sp;
+  mos6510_status_sync(cpu);
+  trace->sr = cpu->sr;
 
   mos6510_trace_index++;
-  if (mos6510_trace_index >= MOS6510_TRACE_BUFFER_SIZE) {
+  if (mos6510_trace_index >= mos6510_trace_size) {
     mos6510_trace_index = 0;
   }
-
-  memcpy(&mos6510_trace_buffer[mos6510_trace_index].cpu,
-    cpu, sizeof(mos6510_t));
-  mc[0] = mem_read(mem, cpu->pc);
-  mc[1] = mem_read(mem, cpu->pc + 1);
-  mc[2] = mem_read(mem, cpu->pc + 2);
-  memcpy(&mos6510_trace_buffer[mos6510_trace_index].mc,
-    mc, sizeof(uint8_t) * 3);
+  if (mos6510_trace_count < mos6510_trace_size) {
+    mos6510_trace_count++;
+  }
 }
 
 
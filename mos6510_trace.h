@@ -2,11 +2,40 @@
 #define _MOS6510_TRACE_H
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "mos6510.h"
 #include "mem.h"
 
-void mos6510_trace_init(void);
-void mos6510_trace_add(mos6510_t *cpu, mem_t *mem);
-void mos6510_trace_dump(FILE *fh);
+#define MOS6510_TRACE_BUFFER_SIZE_DEFAULT 65536
+#define MOS6510_TRACE_BUFFER_SIZE_MAX 16777216
+#define MOS6510_TRACE_DUMP_DEFAULT 20
+
+typedef enum {
+  AM_ACCU, /* A      - Accumulator */
+  AM_IMPL, /* i      - Implied */
+  AM_IMM,  /* #      - Immediate */
+  AM_ABS,  /* a      - Absolute */
+  AM_ABSI, /* (a)    - Indirect Absolute */
+  AM_ABSX, /* a,x    - Absolute + X */
+  AM_ABSY, /* a,y    - Absolute + Y */
+  AM_REL,  /* r      - Relative */
+  AM_ZP,   /* zp     - Zero Page */
+  AM_ZPX,  /* zp,x   - Zero Page + X */
+  AM_ZPY,  /* zp,y   - Zero Page + Y */
+  AM_ZPYI, /* (zp),y - Zero Page Indirect Indexed */
+  AM_ZPIX, /* (zp,x) - Zero Page Indexed Indirect */
+  AM_NONE,
+} mos6510_address_mode_t;
+
+extern bool mos6510_trace_enabled;
+
+int mos6510_trace_init(int size);
+void mos6510_trace_enable(bool enable);
+void mos6510_trace_add(mos6510_t *cpu);
+void mos6510_trace_dump(FILE *fh, mem_t *mem, int count);
+void mos6510_trace_pairs(FILE *fh, mem_t *mem, int count);
+mos6510_address_mode_t mos6510_opcode_address_mode(uint8_t opcode);
+int mos6510_opcode_length(uint8_t opcode);
+void mos6510_disassemble(FILE *fh, uint16_t pc, uint8_t mc[3]);
 
 #endif /* _MOS6510_TRACE_H */
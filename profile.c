@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "profile.h"
+#include "debugger.h"
+#include "mem.h"
+
+#define PROFILE_CURLIN 0x39 /* Current BASIC line, $FFxx in direct mode. */
+#define PROFILE_DIRECT 0xFF00
+
+#define PROFILE_ROUTINE_MAX 1024
+#define PROFILE_ROUTINE_RAM 0 /* Anything not in a known routine. */
+
+#define PROFILE_TABLE_SIZE 0x40000 /* Line and routine pairs, power of 2. */
+#define PROFILE_TABLE_EMPTY UINT32_MAX
+
+typedef struct profile_entry_s {
+  uint32_t key; /* Line in the upper half, routine in the lower. */
+  uint64_t cycles;
+} profile_entry_t;
+
+typedef struct profile_total_s {
+  uint32_t key;
+  uint64_t cycles;
+} profile_total_t;
+
+bool profile_enabled = false;
+
+static mem_t *profile_mem;
+static char *profile_filename;
+
+static const char *profile_routine_name[PROFILE_ROUTINE_MAX];
+static int profile_routine_count;
+static uint16_t profile_routine[UINT16_MAX + 1];
+
+static profile_entry_t *profile_table;
+static int profile_table_used;
+static uint64_t profile_overflow; /* Cycles not fitting in the table. */
+
+static profile_entry_t *profile_current;
+static uint32_t profile_key;
+static uint64_t profile_cycle;
+
+static uint64_t profile_sum[UINT16_MAX + 1]; /* For adding up the pairs. */
+
+
+
+/* Every address in a ROM or in CHRGET belongs to the closest routine in
+   the debugger symbol table at or below it. */
+static void profile_routine_init(void)
+{
+  const char *name;
+  int routine;
+  int address;
+
+  profile_routine_name[PROFILE_ROUTINE_RAM] = "RAM";
+  profile_routine_count = 1;
+  routine = PROFILE_ROUTINE_RAM;
+  for (address = 0; address <= UINT16_MAX; address++) {
+    if (address == 0x008B || address == 0xA000 || address == 0xC000 ||
+        address == 0xE000) {
+      routine = PROFILE_ROUTINE_RAM; /* End of an area. */
+    }
+    name = debugger_symbol(address);
+    if (name != NULL && profile_routine_count < PROFILE_ROUTINE_MAX) {
+      routine = profile_routine_count++;
+      profile_routine_name[routine] = name;
+    }
+    if (address < 0xC000 || address >= 0xE000) {
+      profile_routine[address] = routine;
+    }
+  }
+}
+
+
+
+static inline uint16_t profile_routine_get(uint16_t pc)
+{
+  /* Code run from RAM under the ROMs has nothing to do with them. */
+  if (pc >= 0xA000 &&
+    profile_mem->read_page[pc >> 8] != &profile_mem->rom[pc & 0xFF00]) {
+    return PROFILE_ROUTINE_RAM;
+  }
+  return profile_routine[pc];
+}
+
+
+
+static profile_entry_t *profile_entry(uint32_t key)
+{
+  uint32_t i;
+
+  i = (key * 2654435761u) & (PROFILE_TABLE_SIZE - 1);
+  while (profile_table[i].key != key) {
+    if (profile_table[i].key == PROFILE_TABLE_EMPTY) {
+      if (profile_table_used >= (PROFILE_TABLE_SIZE / 4) * 3) {
+        return NULL;
+      }
+      profile_table[i].key = key;
+      profile_table_used++;
+      break;
+    }
+    i = (i + 1) & (PROFILE_TABLE_SIZE - 1);
+  }
+  return &profile_table[i];
+}
+
+
+
+void profile_mark(uint16_t pc, uint64_t cycle)
+{
+  uint32_t key;
+
+  if (profile_current != NULL) {
+    profile_current->cycles += cycle - profile_cycle;
+  } else if (profile_key != PROFILE_TABLE_EMPTY) {
+    profile_overflow += cycle - profile_cycle;
+  }
+  profile_cycle = cycle;
+
+  key = ((profile_mem->ram[PROFILE_CURLIN] +
+    (profile_mem->ram[PROFILE_CURLIN + 1] * 256)) << 16) |
+    profile_routine_get(pc);
+  if (key != profile_key) {
+    profile_key = key;
+    profile_current = profile_entry(key);
+  }
+}
+
+
+
+static int profile_total_compare(const void *a, const void *b)
+{
+  const profile_total_t *ta = a;
+  const profile_total_t *tb = b;
+
+  if (ta->cycles != tb->cycles) {
+    return (ta->cycles > tb->cycles) ? -1 : 1;
+  }
+  return (ta->key < tb->key) ? -1 : 1;
+}
+
+
+
+static void profile_line_name(char *buffer, size_t size, uint16_t line)
+{
+  if (line >= PROFILE_DIRECT) {
+    snprintf(buffer, size, "DIRECT");
+  } else {
+    snprintf(buffer, size, "%u", line);
+  }
+}
+
+
+
+/* Add up the pairs by line or by routine, sorted by cycles. */
+static int profile_totals(profile_total_t *totals, bool by_line)
+{
+  uint32_t key;
+  int count;
+  int i;
+
+  memset(profile_sum, 0, sizeof(profile_sum));
+  for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+    if (profile_table[i].key == PROFILE_TABLE_EMPTY) {
+      continue;
+    }
+    if (by_line) {
+      key = profile_table[i].key >> 16;
+      if (key >= PROFILE_DIRECT) {
+        key = PROFILE_DIRECT;
+      }
+    } else {
+      key = profile_table[i].key & 0xFFFF;
+    }
+    profile_sum[key] += profile_table[i].cycles;
+  }
+
+  count = 0;
+  for (i = 0; i <= UINT16_MAX; i++) {
+    if (profile_sum[i] > 0) {
+      totals[count].key = i;
+      totals[count].cycles = profile_sum[i];
+      count++;
+    }
+  }
+  qsort(totals, count, sizeof(profile_total_t), profile_total_compare);
+  return count;
+}
+
+
+
+/* Sorted report of the most expensive lines and routines, all of them
+   if count is 0. */
+void profile_report(FILE *fh, int count)
+{
+  profile_total_t *totals;
+  uint64_t sum;
+  char name[8];
+  int n;
+  int i;
+
+  if (profile_table == NULL) {
+    fprintf(fh, "Profiling not enabled.\n");
+    return;
+  }
+  totals = calloc(UINT16_MAX + 1, sizeof(profile_total_t));
+  if (totals == NULL) {
+    return;
+  }
+
+  sum = profile_overflow;
+  for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+    if (profile_table[i].key != PROFILE_TABLE_EMPTY) {
+      sum += profile_table[i].cycles;
+    }
+  }
+  if (sum == 0) {
+    sum = 1;
+  }
+
+  n = profile_totals(totals, true);
+  fprintf(fh, "BASIC Line        Cycles       %%\n");
+  for (i = 0; i < n && (count == 0 || i < count); i++) {
+    profile_line_name(name, sizeof(name), totals[i].key);
+    fprintf(fh, "%-10s %13llu  %6.2f\n", name,
+      (unsigned long long)totals[i].cycles, totals[i].cycles * 100.0 / sum);
+  }
+
+  n = profile_totals(totals, false);
+  fprintf(fh, "\nRoutine           Cycles       %%\n");
+  for (i = 0; i < n && (count == 0 || i < count); i++) {
+    fprintf(fh, "%-10s %13llu  %6.2f\n", profile_routine_name[totals[i].key],
+      (unsigned long long)totals[i].cycles, totals[i].cycles * 100.0 / sum);
+  }
+  if (profile_overflow > 0) {
+    fprintf(fh, "\n%llu cycles not attributed, too many line and routine "
+      "pairs.\n", (unsigned long long)profile_overflow);
+  }
+
+  free(totals);
+}
+
+
+
+/* One "line;routine cycles" entry per pair, as used by flame graph
+   tools. */
+static void profile_folded(FILE *fh)
+{
+  char name[8];
+  int i;
+
+  for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+    if (profile_table[i].key == PROFILE_TABLE_EMPTY ||
+        profile_table[i].cycles == 0) {
+      continue;
+    }
+    profile_line_name(name, sizeof(name), profile_table[i].key >> 16);
+    fprintf(fh, "%s;%s %llu\n", name,
+      profile_routine_name[profile_table[i].key & 0xFFFF],
+      (unsigned long long)profile_table[i].cycles);
+  }
+}
+
+
+
+static void profile_exit(void)
+{
+  FILE *fh;
+  char folded[PATH_MAX];
+
+  fh = fopen(profile_filename, "w");
+  if (fh != NULL) {
+    profile_report(fh, 0);
+    fclose(fh);
+  }
+
+  snprintf(folded, sizeof(folded), "%s.folded", profile_filename);
+  fh = fopen(folded, "w");
+  if (fh != NULL) {
+    profile_folded(fh);
+    fclose(fh);
+  }
+}
+
+
+
+/* Start profiling, with the report written to the file on exit and the
+   folded stacks next to it. */
+int profile_init(mem_t *mem, const char *filename)
+{
+  int i;
+
+  profile_table = malloc(PROFILE_TABLE_SIZE * sizeof(profile_entry_t));
+  if (profile_table == NULL) {
+    return -1;
+  }
+  for (i = 0; i < PROFILE_TABLE_SIZE; i++) {
+    profile_table[i].key = PROFILE_TABLE_EMPTY;
+    profile_table[i].cycles = 0;
+  }
+  profile_table_used = 0;
+  profile_overflow = 0;
+
+  profile_mem = mem;
+  profile_filename = strdup(filename);
+  profile_routine_init();
+  profile_key = PROFILE_TABLE_EMPTY;
+  profile_current = NULL;
+  profile_cycle = 0;
+
+  profile_enabled = true;
+  atexit(profile_exit);
+  return 0;
+}
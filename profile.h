@@ -0,0 +1,26 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "mem.h"
+
+#define PROFILE_REPORT_DEFAULT 20
+
+extern bool profile_enabled;
+
+int profile_init(mem_t *mem, const char *filename);
+void profile_mark(uint16_t pc, uint64_t cycle);
+void profile_report(FILE *fh, int count);
+
+/* Called by the CPU core whenever it starts on a block of instructions,
+   charging the cycles since the last call to where that one was. */
+static inline void profile_check(uint16_t pc, uint64_t cycle)
+{
+  if (profile_enabled) {
+    profile_mark(pc, cycle);
+  }
+}
+
+#endif /* _PROFILE_H */
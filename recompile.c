@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "recompile.h"
+#include "mos6510.h"
+#include "mos6510_trace.h"
+#include "mem.h"
+
+#define RECOMPILE_BASIC_START 0x0801
+#define RECOMPILE_TOKEN_SYS 0x9E
+
+/* Tables in the stock ROMs holding code addresses. */
+#define RECOMPILE_BASIC_VECTORS      0xA000 /* Cold and warm start. */
+#define RECOMPILE_BASIC_STATEMENTS   0xA00C /* Address - 1, for RTS. */
+#define RECOMPILE_BASIC_FUNCTIONS    0xA052
+#define RECOMPILE_BASIC_RAM_VECTORS  0xE447 /* Copied to $0300. */
+#define RECOMPILE_KERNAL_RAM_VECTORS 0xFD30 /* Copied to $0314. */
+
+
+
+static bool recompile_code[UINT16_MAX + 1];   /* Instruction starts. */
+static bool recompile_leader[UINT16_MAX + 1]; /* Basic block starts. */
+static bool recompile_emitted[UINT16_MAX + 1];
+static uint16_t recompile_queue[UINT16_MAX + 1];
+static int recompile_queue_size;
+
+
+
+static uint16_t recompile_vector(mem_t *mem, uint16_t address)
+{
+  return mem_peek(mem, address) + (mem_peek(mem, address + 1) * 256);
+}
+
+
+
+static void recompile_label(uint16_t address)
+{
+  if (recompile_leader[address]) {
+    return;
+  }
+  recompile_leader[address] = true;
+  recompile_queue[recompile_queue_size++] = address;
+}
+
+
+
+static bool recompile_is_branch(uint8_t opcode)
+{
+  return mos6510_opcode_address_mode(opcode) == AM_REL;
+}
+
+
+
+/* Follow one path of execution until control leaves it in a way that
+   cannot be resolved statically, queueing any other known targets. */
+static void recompile_trace(mem_t *mem, uint16_t address)
+{
+  uint8_t opcode;
+  int length;
+
+  while (! recompile_code[address]) {
+    if (mem->read_page[address >> 8] == NULL) {
+      return; /* I/O area. */
+    }
+    opcode = mem_peek(mem, address);
+    if (mos6510_opcode_address_mode(opcode) == AM_NONE) {
+      return; /* Leave JAM and trapped opcodes to the interpreter. */
+    }
+    length = mos6510_opcode_length(opcode);
+    if (address + length - 1 > UINT16_MAX ||
+        mem->read_page[(address + length - 1) >> 8] == NULL) {
+      return;
+    }
+    recompile_code[address] = true;
+
+    if (recompile_is_branch(opcode)) {
+      recompile_label(address + 2 + (int8_t)mem_peek(mem, address + 1));
+      recompile_label(address + 2);
+      return;
+    }
+
+    switch (opcode) {
+    case 0x4C: /* JMP a */
+      recompile_label(recompile_vector(mem, address + 1));
+      return;
+
+    case 0x20: /* JSR a */
+      recompile_label(recompile_vector(mem, address + 1));
+      recompile_label(address + 3); /* Reached by RTS through dispatch. */
+      return;
+
+    case 0x00: /* BRK */
+    case 0x40: /* RTI */
+    case 0x60: /* RTS */
+    case 0x6C: /* JMP (a) */
+      return;
+
+    default:
+      break;
+    }
+
+    address += length;
+  }
+}
+
+
+
+/* Find the target of "SYS <address>" in the first line of a BASIC stub. */
+static int recompile_sys_address(mem_t *mem)
+{
+  uint16_t address;
+  uint8_t c;
+  int target;
+
+  for (address = RECOMPILE_BASIC_START + 4; address < 0x0900; address++) {
+    c = mem->ram[address];
+    if (c == '\0') {
+      return -1;
+    }
+    if (c == RECOMPILE_TOKEN_SYS) {
+      break;
+    }
+  }
+  address++;
+
+  while (mem->ram[address] == ' ' || mem->ram[address] == '(') {
+    address++;
+  }
+  target = 0;
+  while (mem->ram[address] >= '0' && mem->ram[address] <= '9') {
+    target = (target * 10) + (mem->ram[address] - '0');
+    if (target > UINT16_MAX) {
+      return -1;
+    }
+    address++;
+  }
+  return (target > 0) ? target : -1;
+}
+
+
+
+static void recompile_entries(mem_t *mem, uint16_t load_address)
+{
+  int i;
+  int sys;
+
+  if (load_address == RECOMPILE_BASIC_START) {
+    sys = recompile_sys_address(mem);
+    if (sys >= 0) {
+      recompile_label(sys);
+    }
+  } else {
+    recompile_label(load_address);
+  }
+
+  recompile_label(recompile_vector(mem, MOS6510_VECTOR_NMI_LOW));
+  recompile_label(recompile_vector(mem, MOS6510_VECTOR_RESET_LOW));
+  recompile_label(recompile_vector(mem, MOS6510_VECTOR_IRQ_LOW));
+  for (i = 0; i < 16; i++) {
+    recompile_label(recompile_vector(mem,
+      RECOMPILE_KERNAL_RAM_VECTORS + (i * 2)));
+  }
+
+  for (i = 0; i < 2; i++) {
+    recompile_label(recompile_vector(mem, RECOMPILE_BASIC_VECTORS + (i * 2)));
+  }
+  for (i = 0; i < 6; i++) {
+    recompile_label(recompile_vector(mem,
+      RECOMPILE_BASIC_RAM_VECTORS + (i * 2)));
+  }
+  for (i = 0; i < 35; i++) {
+    recompile_label(recompile_vector(mem,
+      RECOMPILE_BASIC_STATEMENTS + (i * 2)) + 1);
+  }
+  for (i = 0; i < 23; i++) {
+    recompile_label(recompile_vector(mem,
+      RECOMPILE_BASIC_FUNCTIONS + (i * 2)));
+  }
+}
+
+
+
+static bool recompile_ends_block(uint8_t opcode)
+{
+  switch (opcode) {
+  case 0x00: /* BRK */
+  case 0x20: /* JSR a */
+  case 0x40: /* RTI */
+  case 0x4C: /* JMP a */
+  case 0x60: /* RTS */
+  case 0x6C: /* JMP (a) */
+    return true;
+
+  default:
+    return recompile_is_branch(opcode);
+  }
+}
+
+
+
+/* Instructions that may store to memory, and so possibly to the block
+   being run, found by the handler name. */
+static bool recompile_writes(uint8_t opcode)
+{
+  static const char *prefix[] = {
+    "st", "inc", "dec", "asl_", "lsr_", "rol_", "ror_", "slo", "rla", "sre",
+    "rra", "sax", "dcp", "isc", "sha", "shx", "shy", "tas", "pha", "php",
+    NULL,
+  };
+  const char *name;
+  int i;
+
+  name = mos6510_opcode_handler(opcode);
+  if (strstr(name, "_accu") != NULL) {
+    return false;
+  }
+  for (i = 0; prefix[i] != NULL; i++) {
+    if (strncmp(name, prefix[i], strlen(prefix[i])) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+/* Find where the basic block starting at an address ends. Blocks are also
+   split on page changes, so the code guard only needs to follow two. */
+static int recompile_block_end(mem_t *mem, int start)
+{
+  int address;
+  uint8_t opcode;
+
+  address = start;
+  do {
+    opcode = mem_peek(mem, address);
+    address += mos6510_opcode_length(opcode);
+    if (recompile_ends_block(opcode)) {
+      break;
+    }
+  } while (address <= UINT16_MAX && recompile_code[address] &&
+           ! recompile_leader[address] && (address >> 8) == (start >> 8));
+  return address;
+}
+
+
+
+static void recompile_emit_block(FILE *fh, mem_t *mem, int start, int end)
+{
+  int address;
+  uint8_t mc[3];
+  uint8_t opcode;
+  int length;
+
+  fprintf(fh, "RECOMPILED_BLOCK(0x%04X)\n{\n", start);
+  fprintf(fh, "  static const uint8_t code[] = {");
+  for (address = start; address < end; address++) {
+    if ((address - start) % 8 == 0) {
+      fprintf(fh, "\n   ");
+    }
+    fprintf(fh, " 0x%02X,", mem_peek(mem, address));
+  }
+  fprintf(fh, "\n  };\n");
+  fprintf(fh, "  RECOMPILED_GUARD(0x%04X, code)\n", start);
+
+  for (address = start; address < end; address += length) {
+    opcode = mem_peek(mem, address);
+    length = mos6510_opcode_length(opcode);
+    mc[0] = opcode;
+    mc[1] = (length > 1) ? mem_peek(mem, address + 1) : 0;
+    mc[2] = (length > 2) ? mem_peek(mem, address + 2) : 0;
+    recompile_emitted[address] = true;
+
+    if (address != start) {
+      fprintf(fh, "  RECOMPILED_NEXT\n");
+    }
+    fprintf(fh, "  /* $%04X: ", address);
+    mos6510_disassemble(fh, address, mc);
+    fprintf(fh, "*/\n");
+    fprintf(fh, "  RECOMPILED_STEP(0x%04X, 0x%02X, %s, ", address, opcode,
+      mos6510_opcode_handler(opcode));
+    if (length > 2) {
+      fprintf(fh, "0x%04X)\n", mc[1] + (mc[2] * 256));
+    } else if (length > 1) {
+      fprintf(fh, "0x%02X)\n", mc[1]);
+    } else {
+      fprintf(fh, "0)\n");
+    }
+
+    if (recompile_writes(opcode) && address + length < end) {
+      fprintf(fh, "  RECOMPILED_WRITTEN(0x%04X)\n", start);
+    }
+  }
+  fprintf(fh, "  RECOMPILED_END\n}\n\n\n\n");
+}
+
+
+
+static void recompile_emit_blocks(FILE *fh, mem_t *mem)
+{
+  int address;
+
+  memset(recompile_emitted, 0, sizeof(recompile_emitted));
+  for (address = 0; address <= UINT16_MAX; address++) {
+    if (! recompile_code[address] || recompile_emitted[address]) {
+      continue;
+    }
+    /* Also reached when instructions overlap or at page changes, make it
+       enterable. */
+    recompile_leader[address] = true;
+    recompile_emit_block(fh, mem, address,
+      recompile_block_end(mem, address));
+  }
+}
+
+
+
+static void recompile_emit(FILE *fh, mem_t *mem, const char *prg_filename)
+{
+  int address;
+
+  fprintf(fh, "/* Generated by tmce64 from '%s', do not edit. */\n",
+    prg_filename);
+  fprintf(fh, "#define RECOMPILED_SOURCE\n");
+  fprintf(fh, "#include \"recompile.h\"\n\n\n\n");
+
+  recompile_emit_blocks(fh, mem);
+
+  fprintf(fh, "void recompiled_run(mos6510_t *cpu, mem_t *mem,\n");
+  fprintf(fh, "  uint64_t *cycle, const uint64_t *until)\n");
+  fprintf(fh, "{\n");
+  fprintf(fh, "  bool running;\n\n");
+  fprintf(fh, "  if (mos6510_mode != MOS6510_MODE_FAST || "
+    "mos6510_trace_enabled ||\n");
+  fprintf(fh, "      debugger_breakpoint_count > 0 || "
+    "mos6510_trap_count > 0 ||\n");
+  fprintf(fh, "      profile_enabled) {\n");
+  fprintf(fh, "    mos6510_run(cpu, mem, cycle, until);\n");
+  fprintf(fh, "    return;\n");
+  fprintf(fh, "  }\n\n");
+
+  fprintf(fh, "  do {\n");
+  fprintf(fh, "    switch (cpu->pc) {\n");
+  for (address = 0; address <= UINT16_MAX; address++) {
+    if (recompile_leader[address] && recompile_code[address]) {
+      fprintf(fh, "    RECOMPILED_CASE(0x%04X)\n", address);
+    }
+  }
+  fprintf(fh, "    default:\n");
+  fprintf(fh, "      running = recompiled_fallback(cpu, mem, cycle, until);\n");
+  fprintf(fh, "      break;\n");
+  fprintf(fh, "    }\n");
+  fprintf(fh, "  } while (running);\n");
+  fprintf(fh, "}\n\n\n\n");
+}
+
+
+
+int recompile_prg(mem_t *mem, const char *prg_filename,
+  const char *c_filename)
+{
+  FILE *fh;
+  uint16_t load_address;
+  int i;
+
+  fh = fopen(prg_filename, "rb");
+  if (fh == NULL) {
+    return -1;
+  }
+  load_address  = fgetc(fh);
+  load_address += fgetc(fh) * 256;
+  fclose(fh);
+
+  if (mem_load_prg(mem, prg_filename) != 0) {
+    return -1;
+  }
+
+  memset(recompile_code, 0, sizeof(recompile_code));
+  memset(recompile_leader, 0, sizeof(recompile_leader));
+  recompile_queue_size = 0;
+
+  recompile_entries(mem, load_address);
+  for (i = 0; i < recompile_queue_size; i++) {
+    recompile_trace(mem, recompile_queue[i]);
+  }
+
+  fh = fopen(c_filename, "w");
+  if (fh == NULL) {
+    return -1;
+  }
+  recompile_emit(fh, mem, prg_filename);
+  fclose(fh);
+  return 0;
+}
+
+
+
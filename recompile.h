@@ -0,0 +1,116 @@
+#ifndef _RECOMPILE_H
+#define _RECOMPILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mos6510.h"
+#include "mos6510_trace.h"
+#include "debugger.h"
+#include "profile.h"
+#include "mem.h"
+
+int recompile_prg(mem_t *mem, const char *prg_filename,
+  const char *c_filename);
+
+/* Provided by the generated source when built with RECOMPILED=FILE. */
+void recompiled_run(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until);
+
+#ifdef RECOMPILED_SOURCE
+/* The generated source is built as part of mos6510.c, so the opcode
+   handlers are called directly and inlined, with the operands and base
+   cycles as constants. */
+
+typedef struct recompiled_guard_s {
+  bool checked;
+  bool valid;
+  uint32_t generation[2]; /* First and last page of the block. */
+} recompiled_guard_t;
+
+/* A block only runs if memory still holds the code seen when recompiling.
+   That is compared once, then only again after the code generation of its
+   pages changed through a write or bank switch. */
+static inline bool recompiled_guard(mem_t *mem, recompiled_guard_t *guard,
+  uint16_t address, const uint8_t *code, int length)
+{
+  uint8_t first;
+  uint8_t last;
+  uint8_t *page;
+  uint16_t i;
+
+  first = address >> 8;
+  last = (address + length - 1) >> 8;
+  if (guard->checked &&
+      mem->code_generation[first] == guard->generation[0] &&
+      mem->code_generation[last] == guard->generation[1]) {
+    return guard->valid;
+  }
+
+  guard->valid = true;
+  for (i = 0; i < length; i++) {
+    page = mem->read_page[(uint16_t)(address + i) >> 8];
+    if (page == NULL || page[(address + i) & 0xFF] != code[i]) {
+      guard->valid = false;
+      break;
+    }
+  }
+  mem_code_mark(mem, first << 8);
+  mem_code_mark(mem, last << 8);
+  guard->generation[0] = mem->code_generation[first];
+  guard->generation[1] = mem->code_generation[last];
+  guard->checked = true;
+  return guard->valid;
+}
+
+static inline bool recompiled_fallback(mos6510_t *cpu, mem_t *mem,
+  uint64_t *cycle, const uint64_t *until)
+{
+  mos6510_execute(cpu, mem);
+  *cycle += cpu->cycles;
+  cpu->cycles = 0;
+  return *cycle < *until && ! debugger_break;
+}
+
+/* Building blocks for the generated source. Each basic block becomes a
+   function returning false once the cycle budget is used up. */
+#define RECOMPILED_BLOCK(address) \
+  static bool recompiled_##address(mos6510_t *cpu, mem_t *mem, \
+    uint64_t *cycle, const uint64_t *until)
+
+#define RECOMPILED_GUARD(address, code) \
+  static recompiled_guard_t guard; \
+  if (! recompiled_guard(mem, &guard, address, code, sizeof(code))) { \
+    return recompiled_fallback(cpu, mem, cycle, until); \
+  }
+
+#define RECOMPILED_STEP(address, opcode, name, operand) \
+  cpu->pc = (uint16_t)(address + opcode_length[opcode]); \
+  op_##name(cpu, mem, operand); \
+  *cycle += opcode_cycles[opcode] + cpu->cycles; \
+  cpu->cycles = 0;
+
+/* After an instruction that may have written to the block itself, the
+   rest is only run if the code is still the same. */
+#define RECOMPILED_WRITTEN(address) \
+  if (mem->code_generation[(address) >> 8] != guard.generation[0] || \
+      mem->code_generation[((address) + sizeof(code) - 1) >> 8] != \
+      guard.generation[1]) { \
+    return *cycle < *until && ! debugger_break; \
+  }
+
+#define RECOMPILED_NEXT \
+  if (*cycle >= *until || debugger_break) { \
+    return false; \
+  }
+
+#define RECOMPILED_END \
+  return *cycle < *until && ! debugger_break;
+
+#define RECOMPILED_CASE(address) \
+  case address: \
+    running = recompiled_##address(cpu, mem, cycle, until); \
+    break;
+
+#endif /* RECOMPILED_SOURCE */
+
+#endif /* _RECOMPILE_H */
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scheduler.h"
+
+
+
+typedef struct scheduler_entry_s {
+  uint64_t cycle;
+  scheduler_handler_t handler;
+  void *data;
+  int position; /* Index into the heap, or -1 if not queued. */
+} scheduler_entry_t;
+
+uint64_t scheduler_cycle = 0;
+uint64_t scheduler_next = UINT64_MAX;
+
+static scheduler_entry_t scheduler_entry[SCHEDULER_EVENT_MAX];
+static scheduler_event_t scheduler_heap[SCHEDULER_EVENT_MAX];
+static int scheduler_heap_size = 0;
+
+
+
+static inline bool scheduler_before(scheduler_event_t a, scheduler_event_t b)
+{
+  if (scheduler_entry[a].cycle == scheduler_entry[b].cycle) {
+    return a < b;
+  }
+  return scheduler_entry[a].cycle < scheduler_entry[b].cycle;
+}
+
+
+
+static inline void scheduler_heap_set(int position, scheduler_event_t event)
+{
+  scheduler_heap[position] = event;
+  scheduler_entry[event].position = position;
+}
+
+
+
+static void scheduler_heap_up(int position)
+{
+  scheduler_event_t event = scheduler_heap[position];
+  int parent;
+
+  while (position > 0) {
+    parent = (position - 1) / 2;
+    if (! scheduler_before(event, scheduler_heap[parent])) {
+      break;
+    }
+    scheduler_heap_set(position, scheduler_heap[parent]);
+    position = parent;
+  }
+  scheduler_heap_set(position, event);
+}
+
+
+
+static void scheduler_heap_down(int position)
+{
+  scheduler_event_t event = scheduler_heap[position];
+  int child;
+
+  while ((child = (position * 2) + 1) < scheduler_heap_size) {
+    if (child + 1 < scheduler_heap_size &&
+        scheduler_before(scheduler_heap[child + 1], scheduler_heap[child])) {
+      child++;
+    }
+    if (! scheduler_before(scheduler_heap[child], event)) {
+      break;
+    }
+    scheduler_heap_set(position, scheduler_heap[child]);
+    position = child;
+  }
+  scheduler_heap_set(position, event);
+}
+
+
+
+static inline void scheduler_next_update(void)
+{
+  if (scheduler_heap_size > 0) {
+    scheduler_next = scheduler_entry[scheduler_heap[0]].cycle;
+  } else {
+    scheduler_next = UINT64_MAX;
+  }
+}
+
+
+
+void scheduler_init(void)
+{
+  int i;
+
+  for (i = 0; i < SCHEDULER_EVENT_MAX; i++) {
+    scheduler_entry[i].cycle = 0;
+    scheduler_entry[i].handler = NULL;
+    scheduler_entry[i].data = NULL;
+    scheduler_entry[i].position = -1;
+  }
+  scheduler_heap_size = 0;
+  scheduler_cycle = 0;
+  scheduler_next = UINT64_MAX;
+}
+
+
+
+void scheduler_attach(scheduler_event_t event,
+  scheduler_handler_t handler, void *data)
+{
+  scheduler_entry[event].handler = handler;
+  scheduler_entry[event].data = data;
+}
+
+
+
+void scheduler_add(scheduler_event_t event, uint64_t cycle)
+{
+  int position = scheduler_entry[event].position;
+
+  scheduler_entry[event].cycle = cycle;
+  if (position < 0) { /* New, insert at the bottom. */
+    position = scheduler_heap_size++;
+    scheduler_heap_set(position, event);
+    scheduler_heap_up(position);
+  } else { /* Already queued, just move it. */
+    scheduler_heap_up(position);
+    scheduler_heap_down(scheduler_entry[event].position);
+  }
+  scheduler_next_update();
+}
+
+
+
+void scheduler_remove(scheduler_event_t event)
+{
+  int position = scheduler_entry[event].position;
+  scheduler_event_t last;
+
+  if (position < 0) {
+    return;
+  }
+
+  scheduler_entry[event].position = -1;
+  scheduler_heap_size--;
+  if (position < scheduler_heap_size) {
+    /* Fill the hole with the last entry and restore the heap. */
+    last = scheduler_heap[scheduler_heap_size];
+    scheduler_heap_set(position, last);
+    scheduler_heap_up(position);
+    scheduler_heap_down(scheduler_entry[last].position);
+  }
+  scheduler_next_update();
+}
+
+
+
+bool scheduler_pending(scheduler_event_t event)
+{
+  return (scheduler_entry[event].position >= 0);
+}
+
+
+
+void scheduler_execute(void)
+{
+  scheduler_event_t event;
+
+  /* Run all events that are due, handlers may queue new ones. */
+  while (scheduler_heap_size > 0) {
+    event = scheduler_heap[0];
+    if (scheduler_entry[event].cycle > scheduler_cycle) {
+      break;
+    }
+    scheduler_remove(event);
+    if (scheduler_entry[event].handler != NULL) {
+      (scheduler_entry[event].handler)(scheduler_entry[event].data,
+        scheduler_entry[event].cycle);
+    }
+  }
+}
+
+
+
@@ -0,0 +1,42 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Events with the same cycle run in this order. */
+typedef enum {
+  SCHEDULER_EVENT_CIA1,
+  SCHEDULER_EVENT_CIA2,
+  SCHEDULER_EVENT_VIC,
+  SCHEDULER_EVENT_SERIAL_BUS,
+  SCHEDULER_EVENT_SID,
+  SCHEDULER_EVENT_CONSOLE,
+  SCHEDULER_EVENT_JOYSTICK,
+  SCHEDULER_EVENT_SYNC,
+  SCHEDULER_EVENT_MAX,
+} scheduler_event_t;
+
+/* Handlers get the cycle the event was due, which may be in the past. */
+typedef void (*scheduler_handler_t)(void *, uint64_t);
+
+extern uint64_t scheduler_cycle; /* Current emulated CPU cycle. */
+extern uint64_t scheduler_next;  /* Cycle of the earliest queued event. */
+
+void scheduler_init(void);
+void scheduler_attach(scheduler_event_t event,
+  scheduler_handler_t handler, void *data);
+void scheduler_add(scheduler_event_t event, uint64_t cycle);
+void scheduler_remove(scheduler_event_t event);
+bool scheduler_pending(scheduler_event_t event);
+void scheduler_execute(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SCHEDULER_H */
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 
 #include "serial_bus.h"
+#include "scheduler.h"
 #include "panic.h"
 
 
@@ -114,9 +115,6 @@ static void serial_bus_trace_init(void)
 static void serial_bus_trace_add(bool data, bool clock, bool atn,
   serial_bus_state_t state, uint8_t byte)
 {
-  static uint32_t cycle = 0;
-  cycle++;
-
   if ((serial_bus_trace_buffer[serial_bus_trace_index].data  == data) &&
       (serial_bus_trace_buffer[serial_bus_trace_index].clock == clock) &&
       (serial_bus_trace_buffer[serial_bus_trace_index].atn   == atn)) {
@@ -132,7 +130,7 @@ static void serial_bus_trace_add(bool data, bool clock, bool atn,
   serial_bus_trace_buffer[serial_bus_trace_index].clock = clock;
   serial_bus_trace_buffer[serial_bus_trace_index].atn   = atn;
   serial_bus_trace_buffer[serial_bus_trace_index].state = state;
-  serial_bus_trace_buffer[serial_bus_trace_index].cycle = cycle;
+  serial_bus_trace_buffer[serial_bus_trace_index].cycle = scheduler_cycle;
   serial_bus_trace_buffer[serial_bus_trace_index].byte  = byte;
 }
 
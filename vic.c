@@ -8,11 +8,82 @@
 #include "vic.h"
 #include "cia.h"
 #include "mos6510.h"
+#include "scheduler.h"
+
+/* Pixel clock should normally increment by 8, but a value of 6 seems to
+   better emulate the VIC-II CPU stunning effect. */
+#define VIC_PIXELS_PER_CYCLE 6
+#define VIC_PIXELS_PER_LINE 403
+#define VIC_LINES 284
+
+
+
+static inline uint32_t vic_lines_to_compare(vic_t *vic)
+{
+  /* Lines until the raster compare line is entered next, 1 to 284. */
+  return ((vic->raster_compare + VIC_LINES - vic->raster_line - 1)
+    % VIC_LINES) + 1;
+}
+
+
+
+static void vic_update(vic_t *vic, uint64_t cycle)
+{
+  uint64_t pixel;
+  uint64_t lines;
+
+  pixel = vic->pixel + ((cycle - vic->cycle) * VIC_PIXELS_PER_CYCLE);
+  vic->cycle = cycle;
+
+  lines = pixel / VIC_PIXELS_PER_LINE;
+  vic->pixel = pixel % VIC_PIXELS_PER_LINE;
+  if (lines == 0) {
+    return;
+  }
+
+  /* Raster IRQ, an event is due on the compare line so it can only have
+     been passed once. */
+  if ((vic->irq_enable & 0x1) && vic->raster_compare < VIC_LINES) {
+    if (lines >= vic_lines_to_compare(vic)) {
+      vic->irq_latch |= 0x1;
+      mos6510_irq((mos6510_t *)vic->cpu, (mem_t *)vic->mem);
+    }
+  }
+
+  vic->raster_line = (vic->raster_line + lines) % VIC_LINES;
+}
+
+
+
+static void vic_schedule(vic_t *vic)
+{
+  uint64_t pixels;
+
+  if ((vic->irq_enable & 0x1) && vic->raster_compare < VIC_LINES) {
+    /* Cycle where the pixel clock enters the compare line. */
+    pixels = ((uint64_t)vic_lines_to_compare(vic) * VIC_PIXELS_PER_LINE) -
+      vic->pixel;
+    scheduler_add(SCHEDULER_EVENT_VIC, vic->cycle +
+      ((pixels + (VIC_PIXELS_PER_CYCLE - 1)) / VIC_PIXELS_PER_CYCLE));
+  } else {
+    scheduler_remove(SCHEDULER_EVENT_VIC);
+  }
+}
+
+
+
+static void vic_event(void *vic, uint64_t cycle)
+{
+  vic_update((vic_t *)vic, cycle);
+  vic_schedule((vic_t *)vic);
+}
 
 
 
 uint8_t vic_read_hook(void *vic, uint16_t address)
 {
+  vic_update((vic_t *)vic, scheduler_cycle);
+
   switch (address & 0x3F) {
   case VIC_CR1:
     return (((vic_t *)vic)->raster_line >> 8) << 7;
@@ -41,15 +112,19 @@ uint8_t vic_read_hook(void *vic, uint16_t address)
 
 void vic_write_hook(void *vic, uint16_t address, uint8_t value)
 {
+  vic_update((vic_t *)vic, scheduler_cycle);
+
   switch (address & 0x3F) {
   case VIC_CR1:
     ((vic_t *)vic)->raster_compare =
       (((vic_t *)vic)->raster_compare & 0x00FF) + ((value >> 7) << 8);
+    vic_schedule((vic_t *)vic);
     break;
 
   case VIC_RASTER:
     ((vic_t *)vic)->raster_compare =
       (((vic_t *)vic)->raster_compare & 0xFF00) + value;
+    vic_schedule((vic_t *)vic);
     break;
 
   case VIC_MP:
@@ -62,6 +137,7 @@ void vic_write_hook(void *vic, uint16_t address, uint8_t value)
 
   case VIC_IE:
     ((vic_t *)vic)->irq_enable = value;
+    vic_schedule((vic_t *)vic);
     break;
 
   case VIC_BG0:
@@ -90,33 +166,13 @@ void vic_init(vic_t *vic)
   vic->raster_compare = 0;
   vic->irq_latch      = 0;
   vic->irq_enable     = 0;
+  vic->cycle          = scheduler_cycle;
 
   vic->cpu = NULL;
   vic->mem = NULL;
-}
-
 
-
-void vic_execute(vic_t *vic)
-{
-  /* Pixel clock should normally increment by 8, but a value of 6 seems to
-     better emulate the VIC-II CPU stunning effect. */
-  vic->pixel += 6;
-  if (vic->pixel >= 403) {
-    vic->pixel = vic->pixel - 403;
-    vic->raster_line++;
-    if (vic->raster_line >= 284) {
-      vic->raster_line = 0;
-    }
-
-    /* Raster IRQ */
-    if (vic->irq_enable & 0x1) {
-      if (vic->raster_line == vic->raster_compare) {
-        vic->irq_latch |= 0x1;
-        mos6510_irq((mos6510_t *)vic->cpu, (mem_t *)vic->mem);
-      }
-    }
-  }
+  scheduler_attach(SCHEDULER_EVENT_VIC, vic_event, vic);
+  vic_schedule(vic);
 }
 
 
@@ -125,6 +181,7 @@ void vic_dump(FILE *fh, vic_t *vic, cia_t *cia2)
 {
   int i;
 
+  vic_update(vic, scheduler_cycle);
   fprintf(fh, "Memory Pointers: 0x%02x\n", vic->mp);
   fprintf(fh, "  Screen Memory: 0x%04x\n",
     (((vic->mp >> 4) & 0xF) * 0x400) +
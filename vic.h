@@ -16,6 +16,7 @@ typedef struct vic_s {
   uint16_t raster_compare;
   uint8_t irq_latch;
   uint8_t irq_enable;
+  uint64_t cycle; /* Raster position is up to date until this cycle. */
   void *cpu;
   void *mem;
 } vic_t;
@@ -30,7 +31,6 @@ typedef struct vic_s {
 uint8_t vic_read_hook(void *vic, uint16_t address);
 void vic_write_hook(void *vic, uint16_t address, uint8_t value);
 void vic_init(vic_t *vic);
-void vic_execute(vic_t *vic);
 void vic_dump(FILE *fh, vic_t *vic, cia_t *cia2);
 
 #endif /* _VIC_H */